@@ -0,0 +1,122 @@
+#define _DEFAULT_SOURCE             // for MAP_ANONYMOUS & MADV_HUGEPAGE
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "jsonarena.h"
+
+/*  -----------------------------------------------------------------
+    bump-pointer arena
+    -----------------------------------------------------------------  */
+
+#define MIN_CHUNK_SIZE   ( 64 * 1024 )
+#define MAX_CHUNK_SIZE   ( 64 * 1024 * 1024 )
+#define HUGE_PAGE_SIZE   ( 2 * 1024 * 1024 )
+
+#if defined(MAP_ANONYMOUS) && defined(MADV_HUGEPAGE)
+#define ARENA_HUGE_PAGES
+#endif
+
+struct _arena_chunk {
+    arena_chunk_t   *next;          // previous chunk in arena
+    size_t          size;           // total size, including this header
+    bool            mapped;         // mapped (huge pages) instead of malloc
+};
+
+#define CHUNK_HEADER_SIZE  ( ( sizeof(arena_chunk_t) + ARENA_ALIGNMENT - 1 ) \
+                             & ~(size_t)( ARENA_ALIGNMENT - 1 ) )
+
+static arena_chunk_t *new_chunk( size_t size, bool huge_pages )
+{
+    arena_chunk_t *chunk;
+#ifdef ARENA_HUGE_PAGES
+    if ( huge_pages ) {
+        size = ( size + HUGE_PAGE_SIZE - 1 ) & ~(size_t)( HUGE_PAGE_SIZE - 1 );
+        void *mem = mmap( NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( MAP_FAILED != mem ) {
+            (void)madvise( mem, size, MADV_HUGEPAGE ); // best effort only
+            chunk = mem;
+            chunk->mapped = true;
+            chunk->size = size;
+            return chunk;
+        }
+    }                               // else fall back to regular pages
+#else
+    (void)huge_pages;
+#endif
+    chunk = malloc( size );
+    if ( NULL == chunk ) return NULL;
+    chunk->mapped = false;
+    chunk->size = size;
+    return chunk;
+}
+
+static void free_chunk( arena_chunk_t *chunk )
+{
+#ifdef ARENA_HUGE_PAGES
+    if ( chunk->mapped ) {
+        munmap( chunk, chunk->size );
+        return;
+    }
+#endif
+    free( chunk );
+}
+
+static bool arena_add_chunk( json_arena_t *arena, size_t size )
+{
+    size += CHUNK_HEADER_SIZE;
+    if ( size < arena->chunk_size ) size = arena->chunk_size;
+
+    arena_chunk_t *chunk = new_chunk( size, arena->huge_pages );
+    if ( NULL == chunk ) return false;
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->next = (unsigned char *)chunk + CHUNK_HEADER_SIZE;
+    arena->limit = (unsigned char *)chunk + chunk->size;
+
+    if ( arena->chunk_size < MAX_CHUNK_SIZE )
+        arena->chunk_size *= 2;     // grow geometrically
+    return true;
+}
+
+extern json_arena_t *json_new_arena( size_t size_hint, bool huge_pages )
+{
+    json_arena_t bootstrap;         // the arena is stored in its first chunk
+    bootstrap.chunks = NULL;
+    bootstrap.next = bootstrap.limit = NULL;
+    bootstrap.chunk_size = MIN_CHUNK_SIZE;
+    bootstrap.huge_pages = huge_pages;
+    bootstrap.heap_refs = 0;
+
+    if ( size_hint > MAX_CHUNK_SIZE ) size_hint = MAX_CHUNK_SIZE;
+    if ( ! arena_add_chunk( &bootstrap, size_hint + sizeof(json_arena_t) ) )
+        return NULL;
+
+    json_arena_t *arena = json_arena_alloc( &bootstrap, sizeof(json_arena_t) );
+    *arena = bootstrap;
+    return arena;
+}
+
+extern void *json_arena_alloc_in_new_chunk( json_arena_t *arena, size_t size )
+{
+    if ( ! arena_add_chunk( arena, size ) ) return NULL;
+
+    void *ptr = arena->next;
+    arena->next += size;
+    return ptr;
+}
+
+extern void json_release_arena( json_arena_t *arena )
+{
+    arena_chunk_t *chunk = arena->chunks;
+    while ( chunk ) {               // the arena itself is in the last chunk
+        arena_chunk_t *next = chunk->next;
+        free_chunk( chunk );
+        chunk = next;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef __JSONARENA_H__
+#define __JSONARENA_H__
+
+/* Internal json library arena allocation.
+
+   An arena is a list of large memory chunks in which a whole parsed tree is
+   allocated by simply moving a pointer forward. Nothing is freed until the
+   whole arena is released in one shot, when the tree root is freed.
+
+   Values, strings, numbers, members and tables allocated in an arena are
+   never freed individually. Containers (object_t and array_t) remember their
+   arena, so that editing can keep extending their tables in the same arena,
+   while new values inserted later remain in the heap. The arena counts those
+   heap values and the live iterators attached to its tree (heap_refs): only
+   if the count is not zero, the tree must be walked before the arena can be
+   released. */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "jsonvalue.h"
+#include "jsondata.h"
+
+#define ARENA_ALIGNMENT  16         // enough for any json data structure
+
+typedef struct _arena_chunk arena_chunk_t;
+
+struct _json_arena {
+    arena_chunk_t   *chunks;        // list of chunks, current chunk first
+    unsigned char   *next;          // next free byte in current chunk
+    unsigned char   *limit;         // end of current chunk
+    size_t          chunk_size;     // minimum size of the next chunk
+    bool            huge_pages;     // try backing chunks with huge pages
+    unsigned int    heap_refs;      // heap values & iterators in arena tree
+    json_value_t    root;           // tree root, stored once parsing is done
+};
+
+/* create a new arena, with a first chunk of about size_hint bytes. If
+   huge_pages is true, chunks are mapped and advised to use huge pages if the
+   system supports them. Return NULL if it cannot be allocated */
+extern json_arena_t *json_new_arena( size_t size_hint, bool huge_pages );
+
+/* allocate size bytes in a new chunk (do not call directly) */
+extern void *json_arena_alloc_in_new_chunk( json_arena_t *arena, size_t size );
+
+/* release the arena and everything that was allocated in it */
+extern void json_release_arena( json_arena_t *arena );
+
+/* return the arena embedding the given root value */
+static inline json_arena_t *json_arena_from_root( json_value_t *root )
+{
+    return (json_arena_t *)( (unsigned char *)root -
+                             offsetof( json_arena_t, root ) );
+}
+
+static inline void *json_arena_alloc( json_arena_t *arena, size_t size )
+{
+    size = ( size + ARENA_ALIGNMENT - 1 ) & ~(size_t)( ARENA_ALIGNMENT - 1 );
+    if ( (size_t)( arena->limit - arena->next ) < size )
+        return json_arena_alloc_in_new_chunk( arena, size );
+
+    void *ptr = arena->next;
+    arena->next += size;
+    return ptr;
+}
+
+/* allocate in the arena if not NULL, in the heap otherwise */
+static inline void *arena_malloc( json_arena_t *arena, size_t size )
+{
+    return ( arena ) ? json_arena_alloc( arena, size ) : malloc( size );
+}
+
+/* free only if not allocated in an arena */
+static inline void arena_free( json_arena_t *arena, void *ptr )
+{
+    if ( NULL == arena ) free( ptr );
+}
+
+#endif /* __JSONARENA_H__ */
@@ -108,20 +108,11 @@ static void parse_args( int argc, const char **argv, arg_struct_t *args )
 static json_value_t *parse_json_file( arg_struct_t *args )
 {
     assert( args->sfile && args->sfsize );
-    unsigned char *buffer = malloc( args->sfsize + 1 );
-    assert( buffer );
-
-    if ( args->sfsize != fread( buffer, 1, args->sfsize, args->sfile ) ) {
-        printf( "jsonc: error reading file %s\n", args->sname );
-        return NULL;
-    }
-
-    buffer[ args->sfsize ] = 0;
     if ( args->verbose ) {
         printf("jsonc: processing json file %s (%lu bytes)\n", args->sname, args->sfsize );
-        printf( "Buffer <%s>\n", buffer );
     }
-    return json_parse_buffer( buffer, (bool)args->comments, NULL );
+    // the file is mapped and parsed in place, instead of read into a buffer
+    return json_parse_file( args->sname, (bool)args->comments, NULL );
 }
 
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
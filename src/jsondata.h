@@ -12,6 +12,12 @@
 
 #include <stdint.h>
 
+/* containers allocated in an arena point to it (see jsonarena.h) */
+typedef struct _json_arena json_arena_t;
+
+/* parsed member names are interned keys (see jsonkey.h) */
+typedef struct _json_key json_key_t;
+
 /*  -----------------------------------------------------------------
     json tree node: value_data_t, which can be:
     - null (no value)
@@ -34,51 +40,52 @@
 
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
 
-#define MIN_MEMBER_NUMBER   16 // this value MUST be a power of 2
-
-/* iterate over members in a hash table with collision list.
-
-
-   The iteration order is first valid main entry, then members in the
-   collision list if it is not empty, and then next valid main entry,
-   and so on, until the end of the main table.
-*/
-typedef struct _member_iterator {
-    struct _member_iterator *next;   // next iterator
-    struct _member          *member; // actual, possibly in a collision list
-    struct _object          *object; // parent object
-} member_iterator_t;
+#define MIN_MEMBER_NUMBER   2  // this value MUST be a power of 2
+#define SMALL_OBJECT_SIZE   8  // max members without index (power of 2)
 
 /*
     Member table:
-    - non-populated entries in the hash table have a NULL pointer
-    - populated entries have a pointer to the member structure, which may
-      point to following members in a collision chain.
-
-    Separate pointers (iprev & inext) are used for iterating over all members.
-    The object keeps track of the first member in the iteration list (ihead).
-    This list is used solely for iterating over the object members in
-    sequential order (hashing is used for random access). The order is the
-    reverse insertion order (last inserted first).
+    Members are stored by value in a dense table, in insertion order, which
+    is also the iteration order. A removed member leaves a hole (NULL name)
+    in the table, until the table is compacted when it must grow.
+
+    Members are located by hash through a separate index, which gives the
+    position of each member in the member table (+1, so that 0 is an empty
+    slot). The index is an open addressing table twice as large as the member
+    table. Its size is a power of 2, so that a hash is reduced to a slot with
+    a simple mask, and collisions are resolved by linear probing.
+
+    Most objects are small, though, and a linear search through a few members
+    is faster than hashing. As long as the member table capacity does not
+    exceed SMALL_OBJECT_SIZE, there is no index (NULL) and members are found
+    by comparing hashes in the table itself. The index is created when the
+    table grows beyond that size.
 */
 typedef struct _member {
-    struct _member      *next;       // linked list only in case of collisions
-    unsigned char       *name;       // member name
+    unsigned char       *name;       // member name, NULL if removed
     json_value_t        *value;      // member value
-    struct _member      *iprev;      // previous in iteration list
-    struct _member      *inext;      // next in iteration list
     uint32_t            hash;        // hash(name)
+    bool                interned;    // name is an interned key
 } member_t;
 
+/* iterate over members in the member table, skipping holes. Iterators are
+   not affected by the removal of members, and the table compaction updates
+   their position. */
+typedef struct _member_iterator {
+    struct _member_iterator *next;   // next iterator
+    struct _object          *object; // parent object
+    uint32_t                position;// next member position in table
+} member_iterator_t;
+
 typedef struct _object {
     member_iterator_t *iterators;    // list of iterators on this object
-    member_t          **members;     // member table
-    member_t          *ihead;        // pointer to head of insertion list
-    member_t          *itail;        // pointer to tail of insertion list
-    uint32_t          nb_used;       // nb members in the table
-    uint32_t          nb_allocated;  // capacity of the table
-    uint32_t          modulo;        // modulo used to locate a hash
-    unsigned int      max_collision; // length of the worst collision chain
+    member_t          *members;      // member table, in insertion order
+    uint32_t          *index;        // member positions + 1, NULL if small
+    json_arena_t      *arena;        // NULL if allocated in the heap
+    uint32_t          nb_used;       // nb members in the object
+    uint32_t          nb_entries;    // nb entries in table, including holes
+    uint32_t          nb_allocated;  // capacity of the member table
+    uint32_t          mask;          // index size - 1
 } object_t;
 
 typedef struct _element_iterator {
@@ -92,6 +99,7 @@ typedef json_value_t element_t;
 typedef struct _array {
     element_iterator_t *iterators;    // list of iterators
     element_t          **elements;    // array of elements *
+    json_arena_t       *arena;        // NULL if allocated in the heap
     unsigned int       nb_allocated;  // array size
     unsigned int       nb_used;       // array portion in use
 } array_t;
@@ -102,6 +110,7 @@ typedef struct _member {
     struct _member  *next;            // next in member list
     unsigned char   *name;
     value_t         *value;
+    bool            interned;         // name is an interned key
 } member_t;
 
 typedef struct _member member_iterator_t;
@@ -116,56 +125,101 @@ typedef struct _element array_t;
 typedef struct _element element_iterator_t;
 #endif
 
+typedef union {
+    long long           integer;
+    double              real;
+} number_data_t;
+
+typedef struct _number {
+    json_number_type_t  ntype;
+    number_data_t       ndata;
+} number_t;
+
+/* Numbers and short strings are stored inline in the value, so that they do
+   not require any other allocation. A short string is at most 15 bytes long
+   (16 with the terminating 0), which covers most keywords, identifiers or
+   enumerated values, while keeping the value size to 24 bytes on 64-bit
+   machines (which costs nothing more than 16 bytes with most allocators). */
+#define SHORT_STRING_SIZE   sizeof(number_t)
+
 typedef union {
     object_t            *object;   // JSON_OBJECT
     array_t             *array;    // JSON_ARRAY
     unsigned char       *string;   // JSON_STRING
-    struct _number      *number;   // JSON_NUMBER
+    unsigned char       short_string[SHORT_STRING_SIZE]; // short JSON_STRING
+    number_t            number;    // JSON_NUMBER
     bool                boolean;   // JSON_BOOLEAN
 } value_data_t;
 
+#define JSON_VALUE_IN_ARENA     0x01  // value allocated in an arena
+#define JSON_VALUE_ARENA_ROOT   0x02  // root value embedded in its arena
+#define JSON_VALUE_SHORT_STRING 0x04  // string stored inline in short_string
+#define JSON_VALUE_STATIC       0x08  // shared immutable value, never freed
+#define JSON_VALUE_IN_SITU      0x10  // string in the parsed text, not freed
+
+// values that are not individually allocated in the heap
+#define JSON_VALUE_NOT_IN_HEAP  ( JSON_VALUE_IN_ARENA | JSON_VALUE_STATIC )
+
 struct _value {
     json_value_type_t   vtype;
+    uint8_t             vflags;    // JSON_VALUE_xxx
     value_data_t        vdata;     // depending on vtype
 };
 
-typedef union {
-    long long           integer;
-    double              real;
-} number_data_t;
-
-typedef struct _number {
-    json_number_type_t  ntype;
-    number_data_t       ndata;
-} number_t;
-
 /* internal use only */
-object_t *new_object( void );
+object_t *new_object( json_arena_t *arena );
 void json_free_object( object_t *object );
 
-member_t *new_member( unsigned char *name, json_value_t *value );
+void set_member( member_t *member, unsigned char *name, json_value_t *value );
+// the member takes over the caller reference on key
+void set_interned_member( member_t *member, json_key_t *key,
+                          json_value_t *value );
+void free_member_name( json_arena_t *arena, member_t *member );
+// the member is copied into the object, or freed if it cannot be attached
 object_t *object_attach_member( object_t *object, member_t *member,
                                 member_t **last_member );
 
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
+// if interned is true, name is an interned key, compared by address only
+// with other interned keys. pslot returns the member index slot if found
+// (or the member position in small objects, without index)
 member_t *object_locate_existing_member( object_t *object, uint32_t hash,
                                          const unsigned char *name,
-                                         unsigned int *pindex );
+                                         bool interned, uint32_t *pslot );
 member_t *object_find_member( object_t *object, const unsigned char *name,
-                              unsigned int *pindex );
-bool object_make_room( object_t *object );
-void object_store_member( object_t *object, unsigned int index, member_t *member );
-void object_remove_member( object_t *object, unsigned int index, member_t *member );
+                              uint32_t *pslot );
+bool object_make_room( object_t *object ); // false if it cannot be extended
+void object_store_member( object_t *object, const member_t *member );
+void object_remove_member( object_t *object, uint32_t slot );
 json_value_t **array_grow( array_t *array ); // return NULL in case of failure
 #endif
 
-array_t *new_array( void );
+array_t *new_array( json_arena_t *arena );
 void json_free_array( array_t *array );
 
 element_t *new_element( json_value_t *value );
 array_t *array_append_element( array_t *array, element_t *element, element_t **last_element );
+// move all elements of tail at the end of array, and free tail. In case of
+// failure, both arrays are freed and NULL is returned
+array_t *array_join( array_t *array, array_t *tail );
+
+/* Shared immutable values for null, true, false and small integers. They are
+   used instead of allocating new values and are never freed nor copied. */
+#define SMALL_INTEGER_MIN   -1
+#define SMALL_INTEGER_MAX   254
+
+json_value_t *get_null_value( void );
+json_value_t *get_boolean_value( bool boolean );
+json_value_t *get_small_integer_value( long long int integer ); // or NULL
+
+// return the shared value equal to value if any, NULL otherwise
+json_value_t *get_shared_value( const json_value_t *value );
+
+void set_number( number_t *number, json_number_type_t nbtype,
+                 long long int integer, double real );
 
-number_t *new_number( json_number_type_t nbtype,
-                      long long int integer, double real );
+/* store a copy of the string in the value, either inline or in the heap.
+   Return false in case of allocation failure */
+bool set_string_copy( json_value_t *value, const unsigned char *string );
 
 #endif /* __JSONDATA_H__ */
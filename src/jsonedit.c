@@ -7,6 +7,21 @@
 #include "jsonedit.h"
 #include "jsondata.h"
 #include "jsonutf8.h"
+#include "jsonarena.h"
+
+/* Values inserted into a tree allocated in an arena stay in the heap. The
+   arena keeps count of them, so that they can be freed with the tree. */
+static inline void attach_value( json_arena_t *arena, json_value_t *value )
+{
+    if ( arena && ! ( value->vflags & JSON_VALUE_NOT_IN_HEAP ) )
+        ++arena->heap_refs;
+}
+
+static inline void detach_value( json_arena_t *arena, json_value_t *value )
+{
+    if ( arena && ! ( value->vflags & JSON_VALUE_NOT_IN_HEAP ) )
+        --arena->heap_refs;
+}
 
 extern json_status_t json_insert_element_into_array( json_value_t *varray,
                                                      unsigned int index,
@@ -35,6 +50,7 @@ extern json_status_t json_insert_element_into_array( json_value_t *varray,
 
     array->elements[ index ] = value;
     ++array->nb_used;
+    attach_value( array->arena, value );
     return JSON_STATUS_SUCCESS;
 }
 
@@ -49,6 +65,8 @@ extern json_value_t *json_replace_element_in_array( json_value_t *varray,
 
     json_value_t *previous_value = array->elements[ index ];
     array->elements[ index ] = value;
+    detach_value( array->arena, previous_value );
+    attach_value( array->arena, value );
     return previous_value;
 }
 
@@ -73,6 +91,7 @@ extern json_value_t *json_remove_element_from_array( json_value_t *varray,
         size_t nb = array->nb_used - index;
         memmove( to, from, nb * sizeof( element_t *) );
     }
+    detach_value( array->arena, value );
     return value;
 }
 
@@ -95,19 +114,20 @@ extern json_status_t json_insert_member_into_object( json_value_t *vobject,
         return JSON_STATUS_DUPLICATE_MEMBER;    // member exists already, bail out
     }
 
-    object_make_room( object );                 // extend if needed/possible
-
-    // duplicate name - copy will be freed with member
-    unsigned char *member_name = (unsigned char *)strdup( (const char *)name );
-    if ( NULL == member_name )
+    if ( ! object_make_room( object ) )         // extend if needed
         return JSON_STATUS_OUT_OF_MEMORY;
 
-    member_t *member = new_member( member_name, value );
-    if ( NULL == member )      // don't free value, it still belongs to caller
+    // duplicate name - copy will be freed with member
+    size_t name_size = 1 + strlen( (const char *)name );
+    unsigned char *member_name = arena_malloc( object->arena, name_size );
+    if ( NULL == member_name ) // don't free value, it still belongs to caller
         return JSON_STATUS_OUT_OF_MEMORY;
+    memcpy( member_name, name, name_size );
 
-    unsigned int index = member->hash % object->modulo;
-    object_store_member( object, index, member );
+    member_t member;
+    set_member( &member, member_name, value );
+    object_store_member( object, &member );
+    attach_value( object->arena, value );
     return JSON_STATUS_SUCCESS;
 }
 
@@ -124,6 +144,8 @@ extern json_value_t *json_replace_member_value_in_object(
 
     json_value_t *previous_value = member->value;
     member->value = value;
+    detach_value( object->arena, previous_value );
+    attach_value( object->arena, value );
     return previous_value;
 }
 
@@ -135,14 +157,22 @@ extern json_value_t *json_remove_member_from_object(
     if ( NULL == vobject || NULL == name || NULL == name_to_free ) return NULL;
 
     object_t *object = vobject->vdata.object;
-    unsigned int index;
-    member_t *member = object_find_member( object, name, &index );
+    uint32_t slot;
+    member_t *member = object_find_member( object, name, &slot );
     if ( NULL == member ) return NULL;
 
-    *name_to_free = member->name;
+    if ( object->arena || member->interned ) {
+        // the caller frees a heap copy of an arena or interned name
+        *name_to_free = (unsigned char *)strdup( (const char *)member->name );
+        if ( NULL == *name_to_free ) return NULL;
+        free_member_name( object->arena, member );
+    } else {
+        *name_to_free = member->name;
+    }
     json_value_t *value = member->value;
 
-    object_remove_member( object, index, member );
+    object_remove_member( object, slot );
+    detach_value( object->arena, value );
     return value;
 }
 
@@ -154,11 +184,17 @@ static inline json_value_t *free_value_return_NULL( json_value_t *v )
 
 extern json_value_t *json_duplicate_value( const json_value_t *value )
 {
+    if ( value ) {      // null, booleans and small integers are never copied
+        json_value_t *shared = get_shared_value( value );
+        if ( shared ) return shared;
+    }
+
     json_value_t *res = malloc( sizeof( json_value_t ) );
     if ( NULL == res ) return NULL;
 
     json_value_type_t vtype = json_get_value_type( value );
     res->vtype = vtype;
+    res->vflags = 0;
 
     json_number_type_t ntype;
     switch( vtype ) {   /* Recursively duplicate the value and its children
@@ -167,7 +203,7 @@ extern json_value_t *json_duplicate_value( const json_value_t *value )
         return free_value_return_NULL( res );
 
     case JSON_OBJECT:
-        res->vdata.object = new_object( );
+        res->vdata.object = new_object( NULL );
         if ( NULL == res->vdata.object ) return free_value_return_NULL( res );
         {
             json_object_iterator_t objit = json_new_object_iterator( value );
@@ -191,7 +227,7 @@ extern json_value_t *json_duplicate_value( const json_value_t *value )
         break;
 
     case JSON_ARRAY:
-        res->vdata.array = new_array( );
+        res->vdata.array = new_array( NULL );
         if ( NULL == res->vdata.array ) return free_value_return_NULL( res );
         {
             json_array_iterator_t arrit = json_new_array_iterator( value );
@@ -214,23 +250,21 @@ extern json_value_t *json_duplicate_value( const json_value_t *value )
         break;
 
     case JSON_STRING:
-        res->vdata.string = (unsigned char *)strdup(
-                                        (const char *)(value->vdata.string) );
-        if ( NULL == res->vdata.string )
-            return free_value_return_NULL( res );
+        if ( ! set_string_copy( res, json_get_string_value( value ) ) ) {
+            free( res );
+            return NULL;
+        }
         break;
 
     case JSON_NUMBER:
         ntype = json_get_value_number_type( value );
         if ( JSON_INTEGER_NUMBER == ntype ) {
-            res->vdata.number = new_number( JSON_INTEGER_NUMBER,
-                                        json_get_integer_value( value ), 0 );
+            set_number( &res->vdata.number, JSON_INTEGER_NUMBER,
+                        json_get_integer_value( value ), 0 );
         } else {
-            res->vdata.number = new_number( JSON_REAL_NUMBER, 0,
-                                        json_get_real_value( value ) );
+            set_number( &res->vdata.number, JSON_REAL_NUMBER, 0,
+                        json_get_real_value( value ) );
         }
-        if ( NULL == res->vdata.number )
-            return free_value_return_NULL( res );
         break;
 
     case JSON_BOOLEAN:
@@ -252,13 +286,14 @@ extern json_value_t *json_new_value( json_value_type_t type, ... )
     if ( NULL == res ) return NULL;
 
     res->vtype = type;
+    res->vflags = 0;
     json_number_type_t nb_type;
     char *string;
     switch( type ) {
     case JSON_STRING: // FIXME: check if string is valid UTF8 here
         string = va_arg(ap, char *);
-        if ( json_is_utf8_string( (unsigned char *)string ) ) {
-            res->vdata.string = (unsigned char *)strdup( string );
+        if ( json_is_utf8_string( (unsigned char *)string ) &&
+             set_string_copy( res, (unsigned char *)string ) ) {
             break;
         } // else falls in default case and return error (next line needed)
         // fall through
@@ -267,19 +302,19 @@ extern json_value_t *json_new_value( json_value_type_t type, ... )
         res = NULL;
         break;
     case JSON_OBJECT:
-        res->vdata.object = new_object( );
+        res->vdata.object = new_object( NULL );
         break;
     case JSON_ARRAY:
-        res->vdata.array = new_array( );
+        res->vdata.array = new_array( NULL );
         break;
     case JSON_NUMBER: // litterate numbers must be suffixed with LL to indicate long long
         nb_type = va_arg( ap, json_number_type_t );
         if ( JSON_INTEGER_NUMBER == nb_type ) {
-            res->vdata.number = new_number( JSON_INTEGER_NUMBER,
-                                            va_arg( ap, long long int), 0 );
+            set_number( &res->vdata.number, JSON_INTEGER_NUMBER,
+                        va_arg( ap, long long int), 0 );
         } else {
-            res->vdata.number = new_number( JSON_REAL_NUMBER, 0,
-                                            va_arg( ap, double) );
+            set_number( &res->vdata.number, JSON_REAL_NUMBER, 0,
+                        va_arg( ap, double) );
         }
         break;
     case JSON_BOOLEAN:
@@ -289,5 +324,13 @@ extern json_value_t *json_new_value( json_value_type_t type, ... )
         break;
     }
     va_end( ap );
+
+    if ( res ) {        // null, booleans and small integers are shared
+        json_value_t *shared = get_shared_value( res );
+        if ( shared ) {
+            free( res );
+            res = shared;
+        }
+    }
     return res;
 }
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "jsonevent.h"
+#include "jsondata.h"
+#include "jsonlex.h"
+
+/*  -----------------------------------------------------------------
+    event parsing
+    -----------------------------------------------------------------  */
+
+typedef struct {
+    json_parse_ctxt_t               lex;
+    const json_event_callbacks_t    *callbacks;
+    void                            *user;
+} event_ctxt_t;
+
+/* call an optional callback, and record the stop request as an error */
+#define EMIT( _ctxt, _event )                                               \
+    ( NULL == (_ctxt)->callbacks->_event ||                                 \
+      (_ctxt)->callbacks->_event( (_ctxt)->user ) || stopped( _ctxt ) )
+
+#define EMIT_DATA( _ctxt, _event, ... )                                     \
+    ( NULL == (_ctxt)->callbacks->_event ||                                 \
+      (_ctxt)->callbacks->_event( (_ctxt)->user, __VA_ARGS__ ) ||           \
+      stopped( _ctxt ) )
+
+static bool stopped( event_ctxt_t *ctxt )
+{
+    json_lex_error( &ctxt->lex, JSON_STATUS_STOPPED,
+                    "parsing stopped by callback" );
+    return false;
+}
+
+/* strings are read in the context name buffer if they fit, or allocated
+   just for the time of the callback */
+static unsigned char *read_string( event_ctxt_t *ctxt )
+{
+    return json_lex_string( &ctxt->lex, ctxt->lex.name_buffer,
+                            NAME_BUFFER_SIZE );
+}
+
+static void release_string( event_ctxt_t *ctxt, unsigned char *string )
+{
+    if ( string != ctxt->lex.name_buffer ) free( string );
+}
+
+static bool emit_string( event_ctxt_t *ctxt, bool is_key )
+{
+    if ( is_key ? NULL == ctxt->callbacks->key
+                : NULL == ctxt->callbacks->string )
+        return json_lex_skip_string( &ctxt->lex );  // checked, not stored
+
+    unsigned char *string = read_string( ctxt );
+    if ( NULL == string ) return false;
+
+    size_t length = strlen( (const char *)string );
+    bool done = ( is_key ) ? EMIT_DATA( ctxt, key, string, length )
+                           : EMIT_DATA( ctxt, string, string, length );
+    release_string( ctxt, string );
+    return done;
+}
+
+static bool emit_number( event_ctxt_t *ctxt )
+{
+    number_t number;
+    if ( ! json_lex_number( &ctxt->lex, &number ) ) return false;
+
+    if ( JSON_INTEGER_NUMBER == number.ntype )
+        return EMIT_DATA( ctxt, integer, number.ndata.integer );
+    return EMIT_DATA( ctxt, real, number.ndata.real );
+}
+
+/* The grammar is processed iteratively, with an explicit stack of open
+   containers, which is limited to MAX_OPEN_DEPTH as in the tree parser */
+static bool parse_events( event_ctxt_t *ctxt )
+{
+    unsigned char stack[MAX_OPEN_DEPTH];    // '{' or '['
+    unsigned int depth = 0;
+    int c;
+
+value:
+    c = json_lex_skip_blank( &ctxt->lex );
+value_char:
+    switch ( c ) {
+    case '{': case '[':
+        if ( depth == MAX_OPEN_DEPTH ) {
+            json_lex_error( &ctxt->lex, JSON_STATUS_OUT_OF_MEMORY,
+                            "ran out of allocated stack depth in processing %s\n",
+                            ( '{' == c ) ? "object" : "array" );
+            return false;
+        }
+        stack[depth++] = (unsigned char)c;
+        if ( '{' == c ) {
+            if ( ! EMIT( ctxt, start_object ) ) return false;
+            c = json_lex_skip_blank( &ctxt->lex );
+            if ( '}' == c ) goto close;     // empty object is ok
+            goto member;
+        }
+        if ( ! EMIT( ctxt, start_array ) ) return false;
+        c = json_lex_skip_blank( &ctxt->lex );
+        if ( ']' == c ) goto close;         // empty array is ok
+        goto value_char;
+    case '"':
+        if ( ! emit_string( ctxt, false ) ) return false;
+        break;
+    case 't': case 'f':
+        if ( ! json_lex_literal( &ctxt->lex, (const unsigned char *)
+                                 ( ( 't' == c ) ? "true" : "false" ) ) )
+            return false;
+        if ( ! EMIT_DATA( ctxt, boolean, 't' == c ) ) return false;
+        break;
+    case 'n':
+        if ( ! json_lex_literal( &ctxt->lex, (const unsigned char *)"null" ) )
+            return false;
+        if ( ! EMIT( ctxt, null ) ) return false;
+        break;
+    case EOF:
+        json_lex_error( &ctxt->lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+                        "Syntax error (end of text) while expecting value" );
+        return false;
+    default:
+        if ( '-' != c && ! isdigit( c ) ) {
+            json_lex_wrong_char_error( &ctxt->lex, "while expecting value", c );
+            return false;
+        }
+        json_lex_push_back( &ctxt->lex, c );    // backtrack 1 char
+        if ( ! emit_number( ctxt ) ) return false;
+        break;
+    }
+
+next:       // a value was parsed
+    if ( 0 == depth ) return true;
+
+    c = json_lex_skip_blank( &ctxt->lex );
+    if ( '{' == stack[depth-1] ) {
+        if ( ',' == c ) {
+            c = json_lex_skip_blank( &ctxt->lex );
+            goto member;
+        }
+        if ( '}' == c ) goto close;
+        json_lex_wrong_char_error( &ctxt->lex, "while expecting object member", c );
+        return false;
+    }
+    if ( ',' == c ) goto value;
+    if ( ']' == c ) goto close;
+    json_lex_wrong_char_error( &ctxt->lex, "while expecting ',' or ']'", c );
+    return false;
+
+member:     // c is the first character of the member
+    if ( '"' != c ) {
+        json_lex_wrong_char_error( &ctxt->lex, "while expecting object member", c );
+        return false;
+    }
+    if ( ! emit_string( ctxt, true ) ) return false;
+    if ( ':' != json_lex_skip_blank( &ctxt->lex ) ) {
+        json_lex_error( &ctxt->lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+            "Syntax error (missing ':') while expecting \"name\" : value" );
+        return false;
+    }
+    goto value;
+
+close:
+    if ( '{' == stack[--depth] ) {
+        if ( ! EMIT( ctxt, end_object ) ) return false;
+    } else {
+        if ( ! EMIT( ctxt, end_array ) ) return false;
+    }
+    goto next;
+}
+
+static json_status_t parse_text( event_ctxt_t *ctxt,
+                                 const json_event_callbacks_t *callbacks,
+                                 void *user, json_error_report_t *error )
+{
+    ctxt->callbacks = callbacks;
+    ctxt->user = user;
+
+    if ( NULL == callbacks ) {
+        json_lex_error( &ctxt->lex, JSON_STATUS_INVALID_PARAMETERS,
+                        "No event callbacks\n" );
+    } else if ( parse_events( ctxt ) ) {
+        int c = json_lex_skip_blank( &ctxt->lex );
+        if ( EOF != c )
+            json_lex_wrong_char_error( &ctxt->lex, "while expecting end of text", c );
+    }
+    json_lex_report( &ctxt->lex, error );
+    return ctxt->lex.ecode;
+}
+
+extern json_status_t json_parse_events( json_source_t *source, bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error )
+{
+    event_ctxt_t ctxt;
+    json_lex_init_source( &ctxt.lex, source, comments );
+    return parse_text( &ctxt, callbacks, user, error );
+}
+
+extern json_status_t json_parse_block_source_events(
+                                        json_block_source_t *source,
+                                        bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error )
+{
+    event_ctxt_t ctxt;
+    json_lex_init_block_source( &ctxt.lex, source, comments );
+    return parse_text( &ctxt, callbacks, user, error );
+}
+
+extern json_status_t json_parse_buffer_events( const unsigned char *buffer,
+                                        size_t len, bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error )
+{
+    event_ctxt_t ctxt;
+    json_lex_init_buffer( &ctxt.lex, buffer, len, comments );
+    if ( NULL == buffer ) {
+        json_lex_error( &ctxt.lex, JSON_STATUS_INVALID_PARAMETERS,
+                        "Empty source buffer\n" );
+        json_lex_report( &ctxt.lex, error );
+        return ctxt.lex.ecode;
+    }
+    return parse_text( &ctxt, callbacks, user, error );
+}
+
+extern json_status_t json_parse_stream_events( FILE *fd, bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error )
+{
+    event_ctxt_t ctxt;
+    json_lex_init_stream( &ctxt.lex, fd, comments );
+    json_status_t status = parse_text( &ctxt, callbacks, user, error );
+    json_lex_release_stream( &ctxt.lex );
+    return status;
+}
+
+/* validation is event parsing without any callback */
+static const json_event_callbacks_t no_callbacks;
+
+extern json_status_t json_validate_buffer( const unsigned char *buffer,
+                                           size_t len, bool comments,
+                                           json_error_report_t *error )
+{
+    return json_parse_buffer_events( buffer, len, comments, &no_callbacks,
+                                     NULL, error );
+}
+
+extern json_status_t json_validate_stream( FILE *fd, bool comments,
+                                           json_error_report_t *error )
+{
+    return json_parse_stream_events( fd, comments, &no_callbacks, NULL, error );
+}
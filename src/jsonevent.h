@@ -0,0 +1,88 @@
+
+#ifndef __JSONEVENT_H__
+#define __JSONEVENT_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "jsonvalue.h"
+#include "jsonparse.h"
+
+/* Event based (SAX style) parsing.
+
+   Instead of building a tree, the parser calls a function for each event
+   in the json text, in the text order: start and end of objects and arrays,
+   member names (key) and scalar values. Text is read exactly as with the
+   tree parser, which reports the same errors, but no value is ever
+   allocated: documents of any size are processed in a constant amount of
+   memory (strings and member names are allocated only while they are passed
+   to the callback if they are longer than 256 bytes). Strings and member
+   names are not even stored if their callback is NULL.
+
+   The strings passed to key and string callbacks are zero-terminated UTF8
+   strings, which are valid only during the call: they must be copied if
+   they are needed afterwards. Any callback may be NULL, in which case the
+   event is just ignored. A callback returns true to continue parsing, or
+   false to stop it, in which case the parsing function returns the status
+   JSON_STATUS_STOPPED.
+
+   The opening and closing of containers are always balanced, except if
+   parsing is stopped or fails. Member names are not checked for duplicates
+   and the events are sent as the text is read: a syntax error may be found
+   after some events were already sent for the invalid document. */
+
+typedef struct {
+    bool (*start_object)( void *user );
+    bool (*key)( void *user, const unsigned char *name, size_t length );
+    bool (*end_object)( void *user );
+    bool (*start_array)( void *user );
+    bool (*end_array)( void *user );
+    bool (*string)( void *user, const unsigned char *string, size_t length );
+    bool (*integer)( void *user, long long int integer );
+    bool (*real)( void *user, double real );
+    bool (*boolean)( void *user, bool boolean );
+    bool (*null)( void *user );
+} json_event_callbacks_t;
+
+/* parse the text from source, accepting C/C++ comments only if the argument
+   comments is true, and call the given callbacks with the user argument.
+
+   It returns JSON_STATUS_SUCCESS once the whole text has been parsed, or an
+   error status. In that case, if the argument error is not NULL, a
+   json_error_report is filled. As with the tree parser, the error string is
+   allocated on the heap and must be freed by the caller after use. */
+extern json_status_t json_parse_events( json_source_t *source, bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error );
+
+/* same as above, for a block source, a buffer of len bytes, or a file, pipe
+   or terminal */
+extern json_status_t json_parse_block_source_events(
+                                        json_block_source_t *source,
+                                        bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error );
+
+extern json_status_t json_parse_buffer_events( const unsigned char *buffer,
+                                        size_t len, bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error );
+
+extern json_status_t json_parse_stream_events( FILE *fd, bool comments,
+                                        const json_event_callbacks_t *callbacks,
+                                        void *user, json_error_report_t *error );
+
+/* Validation only: check that the text is a valid json document, with the
+   same checks and errors as the tree parser (structure, depth, strings,
+   escape sequences, UTF8 encoding and number grammar), but without building
+   or storing anything. Nothing is allocated, except the error string, and
+   for a stream its read buffer. It returns JSON_STATUS_SUCCESS if the text
+   is valid, or the error status, as json_parse_buffer_events does. */
+extern json_status_t json_validate_buffer( const unsigned char *buffer,
+                                           size_t len, bool comments,
+                                           json_error_report_t *error );
+
+extern json_status_t json_validate_stream( FILE *fd, bool comments,
+                                           json_error_report_t *error );
+
+#endif /* __JSONEVENT_H__ */
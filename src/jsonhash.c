@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "jsonhash.h"
+
+/*  -----------------------------------------------------------------
+    seeded member name hashing
+    -----------------------------------------------------------------  */
+
+/* the mode is fixed when the seed is drawn: hash_mode may change only before,
+   under hash_lock, and is then read without lock once seeded */
+static json_hash_mode_t hash_mode = JSON_HASH_FAST;
+static bool             hash_fixed;
+static pthread_mutex_t  hash_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t   hash_seeded = PTHREAD_ONCE_INIT;
+static uint64_t         hash_seed[2];
+
+static inline uint64_t rotate_left( uint64_t x, unsigned int n )
+{
+    return ( x << n ) | ( x >> ( 64 - n ) );
+}
+
+// final avalanche of 64 bits (from MurmurHash3)
+static inline uint64_t mix_64( uint64_t h )
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static void init_seed( void )
+{
+    uint64_t seed[2];
+    bool random = false;
+
+    FILE *fd = fopen( "/dev/urandom", "rb" );
+    if ( fd ) {
+        random = ( 1 == fread( seed, sizeof(seed), 1, fd ) );
+        fclose( fd );
+    }
+    if ( ! random ) {   // not as good, but still different in each process
+        seed[0] = mix_64( (uint64_t)time( NULL ) ^ (uint64_t)(uintptr_t)&seed );
+        seed[1] = mix_64( seed[0] ^ (uint64_t)clock( ) ^
+                          (uint64_t)(uintptr_t)&init_seed );
+    }
+    hash_seed[0] = seed[0];
+    hash_seed[1] = seed[1];
+
+    pthread_mutex_lock( &hash_lock );
+    hash_fixed = true;
+    pthread_mutex_unlock( &hash_lock );
+}
+
+extern json_status_t json_set_member_hashing( json_hash_mode_t mode )
+{
+    pthread_mutex_lock( &hash_lock );
+    if ( ! hash_fixed ) hash_mode = mode;
+    bool selected = ( mode == hash_mode );
+    pthread_mutex_unlock( &hash_lock );
+
+    pthread_once( &hash_seeded, init_seed );
+    return ( selected ) ? JSON_STATUS_SUCCESS : JSON_STATUS_INVALID_PARAMETERS;
+}
+
+// load up to 8 bytes, in the machine byte order
+static inline uint64_t load_tail( const unsigned char *string, size_t length )
+{
+    uint64_t word = 0;
+    memcpy( &word, string, length );
+    return word;
+}
+
+#if defined(__SSE4_2__) || defined(__ARM_FEATURE_CRC32)
+#if defined(__SSE4_2__)
+#define crc32c_64( _crc, _w )   _mm_crc32_u64( (_crc), (_w) )
+#else
+#define crc32c_64( _crc, _w )   __crc32cd( (uint32_t)(_crc), (_w) )
+#endif
+
+static uint32_t fast_hash( const unsigned char *string, size_t length )
+{
+    uint64_t crc = (uint32_t)hash_seed[0];
+    while ( length >= 8 ) {
+        crc = crc32c_64( crc, load_tail( string, 8 ) );
+        string += 8;
+        length -= 8;
+    }
+    crc = crc32c_64( crc, load_tail( string, length ) ^ ( (uint64_t)length << 56 ) );
+    /* CRC is linear: mix it with the other half of the seed */
+    return (uint32_t)mix_64( crc ^ hash_seed[1] );
+}
+#else
+
+#define MULTIPLIER  0x9e3779b97f4a7c15ULL  // 2^64 / golden ratio
+
+static uint32_t fast_hash( const unsigned char *string, size_t length )
+{
+    uint64_t h = hash_seed[0] ^ ( length * MULTIPLIER );
+    while ( length >= 8 ) {
+        h = rotate_left( ( h ^ load_tail( string, 8 ) ) * MULTIPLIER, 29 );
+        string += 8;
+        length -= 8;
+    }
+    h = ( h ^ load_tail( string, length ) ) * MULTIPLIER;
+    return (uint32_t)mix_64( h ^ hash_seed[1] );
+}
+#endif
+
+#define SIP_ROUND( _v0, _v1, _v2, _v3 )                                 \
+    do {                                                                \
+        _v0 += _v1; _v1 = rotate_left( _v1, 13 ); _v1 ^= _v0;           \
+        _v0 = rotate_left( _v0, 32 );                                   \
+        _v2 += _v3; _v3 = rotate_left( _v3, 16 ); _v3 ^= _v2;           \
+        _v0 += _v3; _v3 = rotate_left( _v3, 21 ); _v3 ^= _v0;           \
+        _v2 += _v1; _v1 = rotate_left( _v1, 17 ); _v1 ^= _v2;           \
+        _v2 = rotate_left( _v2, 32 );                                   \
+    } while ( 0 )
+
+// SipHash-1-3, keyed with the seed (words are read in the machine order)
+static uint32_t secure_hash( const unsigned char *string, size_t length )
+{
+    uint64_t v0 = hash_seed[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = hash_seed[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = hash_seed[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = hash_seed[1] ^ 0x7465646279746573ULL;
+    uint64_t last = (uint64_t)length << 56;
+
+    while ( length >= 8 ) {
+        uint64_t m = load_tail( string, 8 );
+        v3 ^= m;
+        SIP_ROUND( v0, v1, v2, v3 );
+        v0 ^= m;
+        string += 8;
+        length -= 8;
+    }
+    last |= load_tail( string, length );
+    v3 ^= last;
+    SIP_ROUND( v0, v1, v2, v3 );
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    SIP_ROUND( v0, v1, v2, v3 );
+    SIP_ROUND( v0, v1, v2, v3 );
+    SIP_ROUND( v0, v1, v2, v3 );
+    uint64_t h = v0 ^ v1 ^ v2 ^ v3;
+    return (uint32_t)( h ^ ( h >> 32 ) );
+}
+
+extern uint32_t json_hash_string( const unsigned char *string, size_t length )
+{
+    // the seed is set once, even if several threads start parsing together
+    pthread_once( &hash_seeded, init_seed );
+
+    if ( JSON_HASH_SECURE == hash_mode )
+        return secure_hash( string, length );
+    return fast_hash( string, length );
+}
@@ -0,0 +1,33 @@
+#ifndef __JSONHASH_H__
+#define __JSONHASH_H__
+
+/* Internal json library member name hashing.
+
+   Member names are hashed with a per-process random seed, so that hash
+   values, and therefore collisions in object indexes and key tables, cannot
+   be predicted from outside. The seed is drawn once, at the first hashing,
+   unless json_set_member_hashing was called before, and the hashing mode is
+   then fixed, so that existing hash values always remain valid.
+
+   In JSON_HASH_FAST mode (default), names are hashed 8 bytes at a time, using
+   the CRC32C instruction if the compiler targets it (-msse4.2 on x86, or
+   +crc on ARM), or a multiply based mixing function otherwise. In
+   JSON_HASH_SECURE mode, names are hashed with SipHash-1-3, which resists
+   hash flooding even if some hash values leak out. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "jsonvalue.h"
+
+/* return the hash value of the length bytes of string */
+extern uint32_t json_hash_string( const unsigned char *string, size_t length );
+
+/* same as above, for a zero terminated string */
+static inline uint32_t UTF8_string_hash( const unsigned char *string )
+{
+    return json_hash_string( string, strlen( (const char *)string ) );
+}
+
+#endif /* __JSONHASH_H__ */
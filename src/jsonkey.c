@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsonkey.h"
+#include "jsonarena.h"
+#include "jsonhash.h"
+
+/*  -----------------------------------------------------------------
+    member name interning
+    -----------------------------------------------------------------  */
+
+#define MIN_KEY_NUMBER   64         // this value MUST be a power of 2
+
+/* open addressing hash table, with linear probing */
+struct _json_key_table {
+    json_key_t      **keys;         // NULL if empty entry
+    uint32_t        nb_used;        // nb keys in the table
+    uint32_t        nb_allocated;   // capacity of the table (power of 2)
+    bool            shared;         // keeps a reference on its keys
+};
+
+static json_key_table_t *new_key_table( bool shared )
+{
+    json_key_table_t *table = malloc( sizeof( json_key_table_t ) );
+    if ( NULL == table ) return NULL;
+
+    table->keys = calloc( MIN_KEY_NUMBER, sizeof( json_key_t * ) );
+    if ( NULL == table->keys ) {
+        free( table );
+        return NULL;
+    }
+    table->nb_used = 0;
+    table->nb_allocated = MIN_KEY_NUMBER;
+    table->shared = shared;
+    return table;
+}
+
+extern json_key_table_t *json_new_key_table( void )
+{
+    return new_key_table( true );
+}
+
+extern json_key_table_t *json_new_private_key_table( void )
+{
+    return new_key_table( false );
+}
+
+extern void json_free_key_table( json_key_table_t *table )
+{
+    if ( NULL == table ) return;
+    if ( table->shared ) {          // keys may outlive the table
+        for ( uint32_t i = 0; i < table->nb_allocated; ++i ) {
+            if ( table->keys[i] )
+                json_release_key( NULL, table->keys[i]->name );
+        }
+    }
+    free( table->keys );
+    free( table );
+}
+
+static bool key_table_grow( json_key_table_t *table )
+{
+    uint32_t nb_allocated = 2 * table->nb_allocated;
+    json_key_t **keys = calloc( nb_allocated, sizeof( json_key_t * ) );
+    if ( NULL == keys ) return false;
+
+    uint32_t mask = nb_allocated - 1;
+    for ( uint32_t i = 0; i < table->nb_allocated; ++i ) {
+        json_key_t *key = table->keys[i];
+        if ( NULL == key ) continue;
+        uint32_t index = key->hash & mask;
+        while ( keys[index] ) index = ( index + 1 ) & mask;
+        keys[index] = key;
+    }
+    free( table->keys );
+    table->keys = keys;
+    table->nb_allocated = nb_allocated;
+    return true;
+}
+
+extern json_key_t *json_intern_key( json_key_table_t *table,
+                                    json_arena_t *arena,
+                                    const unsigned char *name,
+                                    size_t length )
+{
+    uint32_t hash = json_hash_string( name, length );
+    uint32_t mask = table->nb_allocated - 1;
+    uint32_t index = hash & mask;
+
+    json_key_t *key;
+    while ( NULL != ( key = table->keys[index] ) ) {
+        if ( key->hash == hash && key->length == length &&
+             0 == memcmp( key->name, name, length ) ) {
+            ++key->refs;
+            return key;
+        }
+        index = ( index + 1 ) & mask;
+    }
+
+    /* not found: keep at least 25% of entries empty */
+    if ( 4 * ( 1 + table->nb_used ) > 3 * table->nb_allocated ) {
+        if ( ! key_table_grow( table ) ) return NULL;
+        mask = table->nb_allocated - 1;
+        index = hash & mask;
+        while ( table->keys[index] ) index = ( index + 1 ) & mask;
+    }
+
+    key = arena_malloc( arena, sizeof( json_key_t ) + length + 1 );
+    if ( NULL == key ) return NULL;
+    key->refs = ( table->shared ) ? 2 : 1;
+    key->hash = hash;
+    key->length = (uint32_t)length;
+    memcpy( key->name, name, length + 1 );
+
+    table->keys[index] = key;
+    ++table->nb_used;
+    return key;
+}
+
+extern void json_release_key( json_arena_t *arena, const unsigned char *name )
+{
+    if ( arena ) return;            // freed with the arena
+
+    json_key_t *key = json_key_from_name( name );
+    if ( 0 == --key->refs )
+        free( key );
+}
@@ -0,0 +1,53 @@
+#ifndef __JSONKEY_H__
+#define __JSONKEY_H__
+
+/* Internal json library member name interning.
+
+   During parsing, member names are interned in a key table: all members
+   with the same name share a single immutable key, which holds the name
+   with its cached hash and length. Keys are reference counted by members,
+   so that they are freed with the last member using them. A key table is
+   created for each parsed document, unless a shared table is given by the
+   application (see json_new_key_table), in which case the table also keeps
+   a reference on its keys until it is freed.
+
+   Within an object, all interned names come from the same table, so that
+   two different interned name pointers are always different names.
+
+   In an arena, keys are allocated in the arena as anything else and their
+   reference count is not used. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jsonparse.h"
+#include "jsondata.h"
+
+struct _json_key {
+    uint32_t        refs;           // members using the key, + shared table
+    uint32_t        hash;           // hash(name)
+    uint32_t        length;         // strlen(name)
+    unsigned char   name[];         // zero terminated name
+};
+
+static inline json_key_t *json_key_from_name( const unsigned char *name )
+{
+    return (json_key_t *)( name - offsetof( json_key_t, name ) );
+}
+
+/* create a key table, which keeps references on its keys if shared */
+extern json_key_table_t *json_new_private_key_table( void );
+
+/* return the key for the given name, creating it in the table if needed
+   (in the arena if not NULL). A reference is taken for the caller. Return
+   NULL if the key cannot be allocated */
+extern json_key_t *json_intern_key( json_key_table_t *table,
+                                    json_arena_t *arena,
+                                    const unsigned char *name,
+                                    size_t length );
+
+/* release the caller reference on the key of the given interned name */
+extern void json_release_key( json_arena_t *arena, const unsigned char *name );
+
+#endif /* __JSONKEY_H__ */
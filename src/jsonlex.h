@@ -0,0 +1,142 @@
+#ifndef __JSONLEX_H__
+#define __JSONLEX_H__
+
+/* Internal json library lexical analysis.
+
+   The parsing context and the functions reading json tokens are shared by
+   the tree parser (jsonparse.c) and by the parsers that do not build a tree,
+   so that all of them accept exactly the same strings, numbers and literals,
+   and report errors the same way.
+
+   A context reads either from a memory buffer, through a raw cursor (ptr)
+   and an end pointer, or from a json_source_t. In memory, a parser may move
+   the cursor anywhere in the buffer before reading a token. A block source
+   (json_block_source_t) is read the same way, one block at a time, so that
+   the cursor can only move within the current block.
+
+   Lines are not counted while parsing: the position in the text is given by
+   the cursor and the offset of the buffer or block start. The lines of the
+   blocks already read are counted once when the next block is read, and the
+   line and column of an error are found only when the error is reported. */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "jsonparse.h"
+#include "jsondata.h"
+
+#define MAX_ERROR_STRING_LENGTH  512
+#define NAME_BUFFER_SIZE         256   // longer names are allocated
+
+typedef struct {
+    json_source_t         source;          // for file, pipe or terminal sources
+    json_block_source_t   blocks;          // for sources read by blocks
+    const unsigned char   *ptr;            // raw cursor in memory buffer
+    const unsigned char   *end;            // end of memory buffer
+    const unsigned char   *start;          // memory buffer or block, or NULL
+    size_t                base;            // offset of start in the text
+    const unsigned char   *block;          // current source block, or NULL
+    const unsigned char   *block_end;
+    unsigned char         last;            // last char of previous block
+    bool                  at_end;          // end of text was read
+    unsigned int          lines;           // LFs before base - 1
+    size_t                line_start;      // offset following the last one
+    void                  *stream;         // stream read by blocks, or NULL
+    bool                  in_situ;         // strings decoded in the buffer
+    bool                  check_only;      // strings checked, not stored
+
+    struct _string_buffer *head, *current; // for string buffering only
+    json_arena_t          *arena;          // NULL if tree is allocated in heap
+    json_key_table_t      *keys;           // member name interning table
+    bool                  own_keys;        // keys is private to the document
+
+    bool                  comments;        // comments accepted
+    json_status_t         ecode;           // error code, offset & string below
+    size_t                eoffset;
+    unsigned int          eprefix;         // length of position in estring
+    char                  estring[MAX_ERROR_STRING_LENGTH];
+
+    unsigned int          open_stack;      // number of open arrays & objects
+    unsigned int          max_depth;       // limit against DOS attack
+
+    unsigned char         name_buffer[NAME_BUFFER_SIZE]; // name before interning
+} json_parse_ctxt_t;
+
+/* initialize a context for reading len bytes from buffer */
+extern void json_lex_init_buffer( json_parse_ctxt_t *ctxt,
+                                  const unsigned char *buffer, size_t len,
+                                  bool comments );
+
+/* initialize a context for reading from source */
+extern void json_lex_init_source( json_parse_ctxt_t *ctxt,
+                                  const json_source_t *source, bool comments );
+
+/* initialize a context for reading from source, one block at a time */
+extern void json_lex_init_block_source( json_parse_ctxt_t *ctxt,
+                                        const json_block_source_t *source,
+                                        bool comments );
+
+/* initialize a context for reading from a file, pipe or terminal, by blocks
+   if memory allows. The context must be released after use. */
+extern void json_lex_init_stream( json_parse_ctxt_t *ctxt, FILE *fd,
+                                  bool comments );
+
+/* release the stream block used by a context, if any */
+extern void json_lex_release_stream( json_parse_ctxt_t *ctxt );
+
+/* skip blanks (and comments if accepted) and return the next character,
+   which is consumed, or EOF */
+extern int json_lex_skip_blank( json_parse_ctxt_t *ctxt );
+
+/* push back the last character read, so that it is read again */
+extern void json_lex_push_back( json_parse_ctxt_t *ctxt, int c );
+
+/* read a string, after its opening '"'. Return the string stored in buffer
+   if it is not NULL and the string fits in size bytes, or allocated in the
+   context arena or in the heap otherwise. Return NULL in case of error */
+extern unsigned char *json_lex_string( json_parse_ctxt_t *ctxt,
+                                       unsigned char *buffer, size_t size );
+
+/* check a string, after its opening '"', exactly as json_lex_string but
+   without storing it nor allocating anything. Return false in case of error */
+extern bool json_lex_skip_string( json_parse_ctxt_t *ctxt );
+
+/* read a number, starting at its first character (not consumed yet). Return
+   false in case of error */
+extern bool json_lex_number( json_parse_ctxt_t *ctxt, number_t *number );
+
+/* check the literal true, false or null, after its first character. Return
+   false in case of error */
+extern bool json_lex_literal( json_parse_ctxt_t *ctxt,
+                              const unsigned char *literal );
+
+/* report an error in the context (the first error should be kept) */
+extern void json_lex_error( json_parse_ctxt_t *ctxt, json_status_t code,
+                            const char *fmt, ... );
+extern void json_lex_wrong_char_error( json_parse_ctxt_t *ctxt,
+                                       const char *specific, int c );
+
+/* When the cursor is not at the error, set the position of the error reported
+   in the context, in the buffer or block start, which begins at ctxt->base */
+extern void json_lex_set_error_position( json_parse_ctxt_t *ctxt,
+                                         const unsigned char *start,
+                                         const unsigned char *position );
+
+/* account for the block from start to end, entirely read, before reading the
+   next one at offset ctxt->base + (end - start) */
+extern void json_lex_end_block( json_parse_ctxt_t *ctxt,
+                                const unsigned char *start,
+                                const unsigned char *end );
+
+/* fill the error report, if not NULL, from the context */
+extern void json_lex_report( const json_parse_ctxt_t *ctxt,
+                             json_error_report_t *error );
+
+/* parse array elements (values separated by ',') from the context up to its
+   end, as if they were inside an array at depth open_stack, and append them
+   to array. Return the array, or NULL in case of error (the array is freed).
+   This allows the elements of a large array to be parsed by parts. */
+extern array_t *json_parse_elements( json_parse_ctxt_t *ctxt, array_t *array );
+
+#endif /* __JSONLEX_H__ */
@@ -0,0 +1,431 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "jsonlines.h"
+#include "jsonscan.h"
+
+/*  -----------------------------------------------------------------
+    parallel line parsing
+    -----------------------------------------------------------------  */
+
+/* Batches are stored in a ring of slots, 2 per worker so that a worker can
+   start the next batch while the previous one is delivered. The calling
+   thread reads the input into the free slots and delivers the parsed slots
+   in order, whereas workers take the read slots in order. A slot belongs to
+   the thread that changes its state, so that only the slot states and the
+   sequence numbers are protected by the lock. */
+
+#define BATCH_SIZE          ( 256 * 1024 )  // minimum text in a batch
+#define READ_SIZE           ( 64 * 1024 )   // minimum room for reading
+#define BATCHES_PER_WORKER  2
+
+typedef struct {
+    size_t              line;           // in batch, from 0
+    json_value_t        *value;         // NULL once delivered, or if error
+    json_error_report_t error;
+} line_result_t;
+
+typedef enum {
+    BATCH_FREE,             // can be read
+    BATCH_READY,            // read, to be parsed
+    BATCH_PARSED            // to be delivered
+} batch_state_t;
+
+typedef struct {
+    batch_state_t   state;
+    unsigned char   *text;
+    size_t          length;
+    size_t          size;
+    size_t          nb_lines;           // including blank lines
+    line_result_t   *results;           // non blank lines only
+    size_t          nb_results;
+    size_t          max_results;
+    bool            failed;             // results could not be allocated
+} batch_t;
+
+typedef struct {
+    json_source_t   *source;            // NULL unless read by characters
+    json_block_source_t *blocks;        // NULL unless read by blocks
+    FILE            *fd;                // used if both are NULL
+    unsigned char   *carry;             // partial line read from fd
+    size_t          carry_length;
+    size_t          carry_size;
+    bool            eof;
+    bool            comments;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;              // a batch was read, or stop
+    pthread_cond_t  parsed;             // a batch was parsed
+    batch_t         *batches;
+    unsigned int    nb_batches;
+    size_t          fill_seq;           // next batch to read
+    size_t          parse_seq;          // next batch to parse
+    size_t          deliver_seq;        // next batch to deliver
+    bool            stop;
+} lines_ctxt_t;
+
+static bool batch_reserve( batch_t *batch, size_t room )
+{
+    if ( batch->size - batch->length >= room ) return true;
+
+    size_t size = ( batch->size ) ? batch->size : BATCH_SIZE + READ_SIZE;
+    while ( size - batch->length < room ) size *= 2;
+    unsigned char *text = realloc( batch->text, size );
+    if ( NULL == text ) return false;
+    batch->text = text;
+    batch->size = size;
+    return true;
+}
+
+/* append the next bytes read from the stream, or the next block given by
+   the source, to the batch and set *n to their number, 0 at the end */
+static json_status_t read_block( lines_ctxt_t *ctxt, batch_t *batch, size_t *n )
+{
+    if ( NULL == ctxt->blocks ) {
+        if ( ! batch_reserve( batch, READ_SIZE ) )
+            return JSON_STATUS_OUT_OF_MEMORY;
+        *n = fread( batch->text + batch->length, 1,
+                    batch->size - batch->length, ctxt->fd );
+        if ( 0 == *n && ferror( ctxt->fd ) ) return JSON_STATUS_READ_ERROR;
+        return JSON_STATUS_SUCCESS;
+    }
+    const unsigned char *block = NULL;
+    *n = ctxt->blocks->refill( ctxt->blocks, &block );
+    if ( 0 == *n ) return JSON_STATUS_SUCCESS;
+    if ( ! batch_reserve( batch, *n ) ) return JSON_STATUS_OUT_OF_MEMORY;
+    memcpy( batch->text + batch->length, block, *n );
+    return JSON_STATUS_SUCCESS;
+}
+
+/* a batch read by blocks ends at the last LF read after BATCH_SIZE bytes:
+   the following partial line is carried over to the next batch */
+static json_status_t fill_by_blocks( lines_ctxt_t *ctxt, batch_t *batch )
+{
+    if ( ! batch_reserve( batch, ctxt->carry_length + READ_SIZE ) )
+        return JSON_STATUS_OUT_OF_MEMORY;
+    if ( ctxt->carry_length )
+        memcpy( batch->text, ctxt->carry, ctxt->carry_length );
+    batch->length = ctxt->carry_length;
+    ctxt->carry_length = 0;
+
+    while ( true ) {
+        size_t n;
+        json_status_t status = read_block( ctxt, batch, &n );
+        if ( JSON_STATUS_SUCCESS != status ) return status;
+        if ( 0 == n ) {         // end of data
+            ctxt->eof = true;
+            return JSON_STATUS_SUCCESS;
+        }
+        batch->length += n;
+        if ( batch->length < BATCH_SIZE ) continue;
+
+        size_t end = batch->length;
+        while ( end && 0x0a != batch->text[end-1] ) --end;
+        if ( 0 == end ) continue;       // still in a very long line
+
+        size_t tail = batch->length - end;
+        if ( tail > ctxt->carry_size ) {
+            unsigned char *carry = realloc( ctxt->carry, tail );
+            if ( NULL == carry ) return JSON_STATUS_OUT_OF_MEMORY;
+            ctxt->carry = carry;
+            ctxt->carry_size = tail;
+        }
+        memcpy( ctxt->carry, batch->text + end, tail );
+        ctxt->carry_length = tail;
+        batch->length = end;
+        return JSON_STATUS_SUCCESS;
+    }
+}
+
+static json_status_t fill_from_source( lines_ctxt_t *ctxt, batch_t *batch )
+{
+    json_source_t *source = ctxt->source;
+    batch->length = 0;
+    while ( true ) {
+        int c = source->get( source );
+        if ( EOF == c ) {
+            ctxt->eof = true;
+            return JSON_STATUS_SUCCESS;
+        }
+        if ( ! batch_reserve( batch, 1 ) ) return JSON_STATUS_OUT_OF_MEMORY;
+        batch->text[batch->length++] = (unsigned char)c;
+        if ( 0x0a == c && batch->length >= BATCH_SIZE )
+            return JSON_STATUS_SUCCESS;
+    }
+}
+
+static json_status_t fill_batch( lines_ctxt_t *ctxt, batch_t *batch )
+{
+    batch->nb_lines = batch->nb_results = 0;
+    batch->failed = false;
+    return ( ctxt->source ) ? fill_from_source( ctxt, batch )
+                            : fill_by_blocks( ctxt, batch );
+}
+
+static void parse_batch( lines_ctxt_t *ctxt, batch_t *batch )
+{
+    const unsigned char *p = batch->text, *end = p + batch->length;
+
+    size_t nb_lines = 0;
+    for ( const unsigned char *lf = p;
+          lf < end && NULL != ( lf = memchr( lf, 0x0a, end - lf ) ); ++lf )
+        ++nb_lines;
+    if ( batch->length && 0x0a != end[-1] ) ++nb_lines;
+
+    if ( nb_lines > batch->max_results ) {
+        free( batch->results );
+        batch->results = malloc( nb_lines * sizeof( line_result_t ) );
+        if ( NULL == batch->results ) {
+            batch->max_results = 0;
+            batch->failed = true;
+            return;
+        }
+        batch->max_results = nb_lines;
+    }
+    batch->nb_lines = nb_lines;
+
+    for ( size_t line = 0; p < end; ++line ) {
+        const unsigned char *lf = memchr( p, 0x0a, end - p );
+        const unsigned char *line_end = ( lf ) ? lf : end;
+
+        if ( line_end != json_skip_blank_span( p, line_end ) ) {
+            line_result_t *result = &batch->results[batch->nb_results++];
+            result->line = line;
+            result->value = json_parse_buffer_n( p, line_end - p,
+                                                 ctxt->comments,
+                                                 &result->error );
+        }
+        p = line_end + 1;
+    }
+}
+
+static void free_results( batch_t *batch, size_t first )
+{
+    for ( size_t i = first; i < batch->nb_results; ++i ) {
+        if ( batch->results[i].value )
+            json_free( batch->results[i].value );
+        free( batch->results[i].error.error_string );
+    }
+    batch->nb_results = 0;
+}
+
+/* deliver the batch results, starting at input line base_line. Return
+   false if line_fct stopped processing */
+static bool deliver_batch( batch_t *batch, size_t base_line,
+                           json_line_fct line_fct, void *user )
+{
+    for ( size_t i = 0; i < batch->nb_results; ++i ) {
+        line_result_t *result = &batch->results[i];
+        json_value_t *value = result->value;
+        result->value = NULL;           // given to line_fct
+
+        bool done = line_fct( user, base_line + result->line + 1, value,
+                              ( value ) ? NULL : &result->error );
+        free( result->error.error_string );
+        result->error.error_string = NULL;
+        if ( ! done ) {
+            free_results( batch, i + 1 );
+            return false;
+        }
+    }
+    batch->nb_results = 0;
+    return true;
+}
+
+static void *worker( void *arg )
+{
+    lines_ctxt_t *ctxt = arg;
+
+    pthread_mutex_lock( &ctxt->lock );
+    while ( true ) {
+        while ( ! ctxt->stop && ctxt->parse_seq == ctxt->fill_seq )
+            pthread_cond_wait( &ctxt->ready, &ctxt->lock );
+        if ( ctxt->stop ) break;
+
+        batch_t *batch = &ctxt->batches[ctxt->parse_seq++ % ctxt->nb_batches];
+        pthread_mutex_unlock( &ctxt->lock );
+        parse_batch( ctxt, batch );
+        pthread_mutex_lock( &ctxt->lock );
+        batch->state = BATCH_PARSED;
+        pthread_cond_signal( &ctxt->parsed );
+    }
+    pthread_mutex_unlock( &ctxt->lock );
+    return NULL;
+}
+
+/* without workers, each batch is parsed by the calling thread once read */
+static json_status_t process_lines( lines_ctxt_t *ctxt,
+                                    unsigned int nb_workers,
+                                    json_line_fct line_fct, void *user )
+{
+    json_status_t status = JSON_STATUS_SUCCESS;
+    size_t base_line = 0;
+
+    pthread_mutex_lock( &ctxt->lock );
+    while ( true ) {
+        while ( ! ctxt->eof ) {
+            batch_t *batch = &ctxt->batches[ctxt->fill_seq % ctxt->nb_batches];
+            if ( BATCH_FREE != batch->state ) break;
+
+            pthread_mutex_unlock( &ctxt->lock );
+            json_status_t filled = fill_batch( ctxt, batch );
+            if ( JSON_STATUS_SUCCESS == filled && 0 == nb_workers )
+                parse_batch( ctxt, batch );
+            pthread_mutex_lock( &ctxt->lock );
+            if ( JSON_STATUS_SUCCESS != filled ) {
+                status = filled;
+                break;
+            }
+            batch->state = ( nb_workers ) ? BATCH_READY : BATCH_PARSED;
+            ++ctxt->fill_seq;
+            pthread_cond_signal( &ctxt->ready );
+        }
+        if ( JSON_STATUS_SUCCESS != status ||
+             ctxt->deliver_seq == ctxt->fill_seq ) break;
+
+        batch_t *batch = &ctxt->batches[ctxt->deliver_seq % ctxt->nb_batches];
+        if ( BATCH_PARSED != batch->state ) {
+            pthread_cond_wait( &ctxt->parsed, &ctxt->lock );
+            continue;
+        }
+        pthread_mutex_unlock( &ctxt->lock );
+        if ( batch->failed )
+            status = JSON_STATUS_OUT_OF_MEMORY;
+        else if ( ! deliver_batch( batch, base_line, line_fct, user ) )
+            status = JSON_STATUS_STOPPED;
+        base_line += batch->nb_lines;
+        pthread_mutex_lock( &ctxt->lock );
+        batch->state = BATCH_FREE;
+        ++ctxt->deliver_seq;
+        if ( JSON_STATUS_SUCCESS != status ) break;
+    }
+    ctxt->stop = true;
+    pthread_cond_broadcast( &ctxt->ready );
+    pthread_mutex_unlock( &ctxt->lock );
+    return status;
+}
+
+static void report( json_error_report_t *error, json_status_t status )
+{
+    if ( NULL == error ) return;
+    error->status = status;
+    error->offset = 0;
+    switch ( status ) {
+    case JSON_STATUS_SUCCESS:
+        error->error_string = NULL;
+        break;
+    case JSON_STATUS_STOPPED:
+        error->error_string = strdup( "json_parse_lines: parsing stopped by callback" );
+        break;
+    case JSON_STATUS_READ_ERROR:
+        error->error_string = strdup( "json_parse_lines: read error" );
+        break;
+    default:
+        error->error_string = strdup( "json_parse_lines: out of memory" );
+        break;
+    }
+}
+
+static json_status_t parse_lines( lines_ctxt_t *ctxt, unsigned int nthreads,
+                                  json_line_fct line_fct, void *user,
+                                  json_error_report_t *error )
+{
+    if ( 0 == nthreads ) {
+        long nb_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        nthreads = ( nb_cpus > 0 ) ? (unsigned int)nb_cpus : 1;
+    }
+    unsigned int nb_workers = ( nthreads > 1 ) ? nthreads : 0;
+
+    ctxt->carry = NULL;
+    ctxt->carry_length = ctxt->carry_size = 0;
+    ctxt->eof = false;
+    ctxt->fill_seq = ctxt->parse_seq = ctxt->deliver_seq = 0;
+    ctxt->stop = false;
+    ctxt->nb_batches = ( nb_workers ) ? BATCHES_PER_WORKER * nb_workers : 1;
+    ctxt->batches = calloc( ctxt->nb_batches, sizeof( batch_t ) );
+    pthread_t *threads = malloc( ( nb_workers + 1 ) * sizeof( pthread_t ) );
+    if ( NULL == ctxt->batches || NULL == threads ) {
+        free( ctxt->batches );
+        free( threads );
+        report( error, JSON_STATUS_OUT_OF_MEMORY );
+        return JSON_STATUS_OUT_OF_MEMORY;
+    }
+    for ( unsigned int i = 0; i < ctxt->nb_batches; ++i )
+        ctxt->batches[i].state = BATCH_FREE;
+
+    pthread_mutex_init( &ctxt->lock, NULL );
+    pthread_cond_init( &ctxt->ready, NULL );
+    pthread_cond_init( &ctxt->parsed, NULL );
+
+    /* if some threads cannot be created, go on with the others, or in the
+       calling thread if none could be created */
+    unsigned int nb_started = 0;
+    while ( nb_started < nb_workers &&
+            0 == pthread_create( &threads[nb_started], NULL, worker, ctxt ) )
+        ++nb_started;
+
+    json_status_t status = process_lines( ctxt, nb_started, line_fct, user );
+
+    for ( unsigned int i = 0; i < nb_started; ++i )
+        pthread_join( threads[i], NULL );
+    free( threads );
+
+    pthread_cond_destroy( &ctxt->parsed );
+    pthread_cond_destroy( &ctxt->ready );
+    pthread_mutex_destroy( &ctxt->lock );
+
+    for ( unsigned int i = 0; i < ctxt->nb_batches; ++i ) {
+        free_results( &ctxt->batches[i], 0 );
+        free( ctxt->batches[i].results );
+        free( ctxt->batches[i].text );
+    }
+    free( ctxt->batches );
+    free( ctxt->carry );
+
+    report( error, status );
+    return status;
+}
+
+extern json_status_t json_parse_lines( json_source_t *source, bool comments,
+                                       unsigned int nthreads,
+                                       json_line_fct line_fct, void *user,
+                                       json_error_report_t *error )
+{
+    lines_ctxt_t ctxt;
+    ctxt.source = source;
+    ctxt.blocks = NULL;
+    ctxt.fd = NULL;
+    ctxt.comments = comments;
+    return parse_lines( &ctxt, nthreads, line_fct, user, error );
+}
+
+extern json_status_t json_parse_block_source_lines( json_block_source_t *source,
+                                                    bool comments,
+                                                    unsigned int nthreads,
+                                                    json_line_fct line_fct,
+                                                    void *user,
+                                                    json_error_report_t *error )
+{
+    lines_ctxt_t ctxt;
+    ctxt.source = NULL;
+    ctxt.blocks = source;
+    ctxt.fd = NULL;
+    ctxt.comments = comments;
+    return parse_lines( &ctxt, nthreads, line_fct, user, error );
+}
+
+extern json_status_t json_parse_stream_lines( FILE *fd, bool comments,
+                                              unsigned int nthreads,
+                                              json_line_fct line_fct,
+                                              void *user,
+                                              json_error_report_t *error )
+{
+    lines_ctxt_t ctxt;
+    ctxt.source = NULL;
+    ctxt.blocks = NULL;
+    ctxt.fd = fd;
+    ctxt.comments = comments;
+    return parse_lines( &ctxt, nthreads, line_fct, user, error );
+}
@@ -0,0 +1,71 @@
+
+#ifndef __JSONLINES_H__
+#define __JSONLINES_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "jsonvalue.h"
+#include "jsonparse.h"
+
+/* Parallel parsing of newline delimited json (NDJSON or JSON lines).
+
+   The text is made of independent json values, one per line. It is read in
+   batches of lines by the calling thread, while the batches are parsed by a
+   pool of worker threads, each line with json_parse_buffer_n, so that each
+   line is a separate document. Blank lines are ignored.
+
+   The results are delivered in the input order, by calling a function in
+   the calling thread, never in a worker thread, so that the function does
+   not need to be thread safe. It receives the input line number (starting
+   at 1) and either the parsed value, which is given to the function and
+   must be freed by calling json_free after use, or NULL and the error
+   report for that line (the error line in the report is always 1, and the
+   error string is freed after the call). The function returns true to
+   continue, or false to stop processing. Since lines are read and parsed by
+   batches, a line is delivered only once its whole batch has been read.
+
+   Since member names are interned per document, the worker threads do not
+   share anything, except the shared immutable values (null, booleans and
+   small integers). */
+
+typedef bool (*json_line_fct)( void *user, size_t line, json_value_t *value,
+                               const json_error_report_t *error );
+
+/* parse the lines read from source, accepting C/C++ comments in each line
+   only if the argument comments is true, with nthreads worker threads (if
+   nthreads is 0, one per online processor, and if it is 1, the lines are
+   parsed in the calling thread). Each result is passed to the function
+   line_fct with the user argument.
+
+   It returns JSON_STATUS_SUCCESS once all lines have been delivered, even
+   if some of them were invalid, JSON_STATUS_STOPPED if line_fct returned
+   false, JSON_STATUS_OUT_OF_MEMORY if memory cannot be allocated, or
+   JSON_STATUS_READ_ERROR if the stream cannot be read. In that case, if the
+   argument error is not NULL, a json_error_report is filled and the error
+   string must be freed after use. If some worker threads cannot be created,
+   the lines are parsed by the others, or by the calling thread if none could
+   be created.
+   The source is read sequentially, from the calling thread only. */
+extern json_status_t json_parse_lines( json_source_t *source, bool comments,
+                                       unsigned int nthreads,
+                                       json_line_fct line_fct, void *user,
+                                       json_error_report_t *error );
+
+/* same as above, from a source read by blocks */
+extern json_status_t json_parse_block_source_lines( json_block_source_t *source,
+                                                    bool comments,
+                                                    unsigned int nthreads,
+                                                    json_line_fct line_fct,
+                                                    void *user,
+                                                    json_error_report_t *error );
+
+/* same as above, directly from a file, pipe or terminal, which is read by
+   blocks instead of one character at a time */
+extern json_status_t json_parse_stream_lines( FILE *fd, bool comments,
+                                              unsigned int nthreads,
+                                              json_line_fct line_fct,
+                                              void *user,
+                                              json_error_report_t *error );
+
+#endif /* __JSONLINES_H__ */
@@ -0,0 +1,539 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "jsonondemand.h"
+#include "jsondata.h"
+#include "jsonlex.h"
+#include "jsonscan.h"
+
+/*  -----------------------------------------------------------------
+    on-demand document
+    -----------------------------------------------------------------  */
+
+struct _json_ondemand_doc {
+    json_parse_ctxt_t   lex;        // text, value readers and errors
+    const unsigned char *buffer;
+    unsigned char       *name;      // last member name, if allocated
+};
+
+extern json_ondemand_doc_t *json_ondemand_new_doc( const unsigned char *buffer,
+                                                   size_t len )
+{
+    if ( NULL == buffer ) return NULL;
+
+    json_ondemand_doc_t *doc = malloc( sizeof( json_ondemand_doc_t ) );
+    if ( NULL == doc ) return NULL;
+
+    json_lex_init_buffer( &doc->lex, buffer, len, false );
+    doc->buffer = buffer;
+    doc->name = NULL;
+    return doc;
+}
+
+static void release_member_name( json_ondemand_doc_t *doc )
+{
+    free( doc->name );
+    doc->name = NULL;
+}
+
+extern void json_ondemand_free_doc( json_ondemand_doc_t *doc )
+{
+    if ( NULL == doc ) return;
+    release_member_name( doc );
+    free( doc );
+}
+
+extern void json_ondemand_get_error_report( const json_ondemand_doc_t *doc,
+                                            json_error_report_t *error )
+{
+    if ( NULL == doc ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return;
+    }
+    json_lex_report( &doc->lex, error );
+}
+
+/* each access starts without error. The error position is set from the
+   value position, since the cursor is moved around in the text */
+static void start_access( json_ondemand_doc_t *doc )
+{
+    doc->lex.ecode = JSON_STATUS_SUCCESS;
+    doc->lex.estring[0] = 0;
+    doc->lex.eoffset = 0;
+}
+
+static json_status_t text_error( json_ondemand_doc_t *doc,
+                                 const unsigned char *position )
+{
+    json_lex_set_error_position( &doc->lex, doc->buffer, position );
+    return doc->lex.ecode;
+}
+
+static inline int char_at( const json_ondemand_doc_t *doc,
+                           const unsigned char *p )
+{
+    return ( p < doc->lex.end ) ? *p : EOF;
+}
+
+static json_status_t syntax_error( json_ondemand_doc_t *doc,
+                                   const unsigned char *position,
+                                   const char *specific )
+{
+    json_lex_wrong_char_error( &doc->lex, specific, char_at( doc, position ) );
+    return text_error( doc, position );
+}
+
+static inline const unsigned char *skip_blank( const json_ondemand_doc_t *doc,
+                                               const unsigned char *p )
+{
+    return json_skip_blank_span( p, doc->lex.end );
+}
+
+static inline bool is_delimiter( int c )
+{
+    switch ( c ) {
+    case ' ': case '\t': case '\n': case '\r':
+    case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+        return true;
+    }
+    return false;
+}
+
+// after blanks, any other character starts a value, possibly invalid
+static inline bool is_value_start( int c )
+{
+    switch ( c ) {
+    case EOF: case '}': case ']': case ':': case ',':
+        return false;
+    }
+    return true;
+}
+
+/*  -----------------------------------------------------------------
+    skipping values
+    -----------------------------------------------------------------  */
+
+/* skip a string after its opening '"', without checking it. Return a
+   pointer after the closing '"' or NULL if the string is not terminated */
+static const unsigned char *skip_string( json_ondemand_doc_t *doc,
+                                         const unsigned char *p )
+{
+    const unsigned char *end = doc->lex.end;
+    bool non_ascii;
+
+    while ( p < end ) {
+        p = json_scan_string_span( p, end, &non_ascii );
+        if ( p >= end ) break;
+        if ( '"' == *p ) return p + 1;
+        p += ( '\\' == *p ) ? 2 : 1;    // control characters are not checked
+    }
+    json_lex_error( &doc->lex, JSON_STATUS_INVALID_STRING, "unterminated string" );
+    text_error( doc, end );
+    return NULL;
+}
+
+/* skip a whole value by matching brackets, without checking it. Return a
+   pointer after the value or NULL in case of error */
+static const unsigned char *skip_value( json_ondemand_doc_t *doc,
+                                        const unsigned char *p )
+{
+    const unsigned char *end = doc->lex.end;
+
+    switch ( *p ) {
+    case '"':
+        return skip_string( doc, p + 1 );
+
+    case '{': case '[':
+        {
+            unsigned int depth = 0;
+            while ( p < end ) {
+                switch ( *p ) {
+                case '"':
+                    p = skip_string( doc, p + 1 );
+                    if ( NULL == p ) return NULL;
+                    continue;
+                case '{': case '[':
+                    ++depth;
+                    break;
+                case '}': case ']':
+                    if ( 0 == --depth ) return p + 1;
+                    break;
+                }
+                ++p;
+            }
+            syntax_error( doc, end, "while expecting end of object or array" );
+            return NULL;
+        }
+
+    default:
+        while ( p < end && ! is_delimiter( *p ) ) ++p;
+        return p;
+    }
+}
+
+/*  -----------------------------------------------------------------
+    navigating containers
+    -----------------------------------------------------------------  */
+
+extern json_status_t json_ondemand_get_root( json_ondemand_doc_t *doc,
+                                             json_ondemand_value_t *root )
+{
+    if ( NULL == doc || NULL == root ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    start_access( doc );
+
+    const unsigned char *p = skip_blank( doc, doc->buffer );
+    if ( p >= doc->lex.end )
+        return syntax_error( doc, p, "while expecting value" );
+
+    root->doc = doc;
+    root->position = p;
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_value_type_t json_ondemand_get_value_type(
+                                        const json_ondemand_value_t *value )
+{
+    if ( NULL == value || NULL == value->doc ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NOT_A_JSON_VALUE;
+    }
+    switch ( *value->position ) {
+    case '{':               return JSON_OBJECT;
+    case '[':               return JSON_ARRAY;
+    case '"':               return JSON_STRING;
+    case 't': case 'f':     return JSON_BOOLEAN;
+    case 'n':               return JSON_NULL;
+    case '-':               return JSON_NUMBER;
+    default:
+        if ( isdigit( *value->position ) ) return JSON_NUMBER;
+        return NOT_A_JSON_VALUE;
+    }
+}
+
+/* move to the next member (at its opening '"') or element in a container,
+   and return JSON_STATUS_OUT_OF_BOUND at the end of the container */
+static json_status_t next_item( json_ondemand_iterator_t *iterator )
+{
+    json_ondemand_doc_t *doc = iterator->doc;
+    const unsigned char *p = iterator->position;
+
+    if ( ! iterator->first ) {      // skip the last value returned
+        p = skip_value( doc, p );
+        if ( NULL == p ) return doc->lex.ecode;
+    }
+    p = skip_blank( doc, p );
+    if ( iterator->close == char_at( doc, p ) )
+        return JSON_STATUS_OUT_OF_BOUND;
+
+    bool in_object = ( '}' == iterator->close );
+    if ( ! iterator->first ) {
+        if ( ',' != char_at( doc, p ) )
+            return syntax_error( doc, p, ( in_object ) ?
+                                         "while expecting object member" :
+                                         "while expecting ',' or ']'" );
+        p = skip_blank( doc, p + 1 );
+    }
+    iterator->first = false;
+
+    if ( in_object ) {
+        if ( '"' != char_at( doc, p ) )
+            return syntax_error( doc, p, "while expecting object member" );
+    } else if ( ! is_value_start( char_at( doc, p ) ) ) {
+        return syntax_error( doc, p, "while expecting value" );
+    }
+    iterator->position = p;
+    return JSON_STATUS_SUCCESS;
+}
+
+/* after a member name, move to the member value */
+static json_status_t member_value( json_ondemand_iterator_t *iterator,
+                                   const unsigned char *p )
+{
+    json_ondemand_doc_t *doc = iterator->doc;
+
+    p = skip_blank( doc, p );
+    if ( ':' != char_at( doc, p ) ) {
+        json_lex_error( &doc->lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+            "Syntax error (missing ':') while expecting \"name\" : value" );
+        return text_error( doc, p );
+    }
+    p = skip_blank( doc, p + 1 );
+    if ( ! is_value_start( char_at( doc, p ) ) )
+        return syntax_error( doc, p, "while expecting value" );
+
+    iterator->position = p;
+    return JSON_STATUS_SUCCESS;
+}
+
+static void set_value( json_ondemand_value_t *value,
+                       const json_ondemand_iterator_t *iterator )
+{
+    value->doc = iterator->doc;
+    value->position = iterator->position;
+}
+
+/* compare the member name at p (after its opening '"') with name, and
+   return 1 if it matches, 0 if not or -1 in case of error. Names without
+   escape sequences are compared in place, others are decoded first */
+static int match_member_name( json_ondemand_doc_t *doc, const unsigned char **pp,
+                              const unsigned char *name, size_t length )
+{
+    const unsigned char *p = *pp;
+    bool non_ascii = false;
+    const unsigned char *q = json_scan_string_span( p, doc->lex.end, &non_ascii );
+    if ( q < doc->lex.end && '"' == *q ) {
+        *pp = q + 1;
+        return ( (size_t)( q - p ) == length && 0 == memcmp( p, name, length ) );
+    }
+
+    doc->lex.ptr = p;
+    unsigned char *decoded = json_lex_string( &doc->lex, doc->lex.name_buffer,
+                                              NAME_BUFFER_SIZE );
+    if ( NULL == decoded ) {
+        text_error( doc, doc->lex.ptr );
+        return -1;
+    }
+    int match = ( 0 == strcmp( (const char *)decoded, (const char *)name ) );
+    if ( decoded != doc->lex.name_buffer ) free( decoded );
+    *pp = doc->lex.ptr;
+    return match;
+}
+
+static json_status_t init_iterator( const json_ondemand_value_t *container,
+                                    json_ondemand_iterator_t *iterator )
+{
+    iterator->doc = container->doc;
+    iterator->position = container->position + 1;
+    iterator->close = ( '{' == *container->position ) ? '}' : ']';
+    iterator->first = true;
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_status_t json_ondemand_search_for_object_member_by_name(
+                                        const json_ondemand_value_t *object,
+                                        const unsigned char *name,
+                                        json_ondemand_value_t *member )
+{
+    if ( NULL == object || NULL == object->doc || NULL == name || NULL == member ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    if ( '{' != *object->position ) return JSON_STATUS_NOT_AN_OBJECT;
+    start_access( object->doc );
+
+    json_ondemand_iterator_t iterator;
+    init_iterator( object, &iterator );
+
+    size_t length = strlen( (const char *)name );
+    json_status_t status;
+    while ( JSON_STATUS_SUCCESS == ( status = next_item( &iterator ) ) ) {
+        const unsigned char *p = iterator.position + 1;
+        int match = match_member_name( iterator.doc, &p, name, length );
+        if ( -1 == match ) return iterator.doc->lex.ecode;
+
+        status = member_value( &iterator, p );
+        if ( JSON_STATUS_SUCCESS != status ) return status;
+        if ( match ) {
+            set_value( member, &iterator );
+            return JSON_STATUS_SUCCESS;
+        }
+    }
+    return ( JSON_STATUS_OUT_OF_BOUND == status ) ? JSON_STATUS_NOT_A_MEMBER
+                                                  : status;
+}
+
+extern json_status_t json_ondemand_get_array_element(
+                                        const json_ondemand_value_t *array,
+                                        size_t index,
+                                        json_ondemand_value_t *element )
+{
+    if ( NULL == array || NULL == array->doc || NULL == element ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    if ( '[' != *array->position ) return JSON_STATUS_NOT_AN_ARRAY;
+    start_access( array->doc );
+
+    json_ondemand_iterator_t iterator;
+    init_iterator( array, &iterator );
+
+    json_status_t status;
+    do {
+        status = next_item( &iterator );
+        if ( JSON_STATUS_SUCCESS != status ) return status;
+    } while ( index-- );
+
+    set_value( element, &iterator );
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_status_t json_ondemand_new_iterator(
+                                        const json_ondemand_value_t *container,
+                                        json_ondemand_iterator_t *iterator )
+{
+    if ( NULL == container || NULL == container->doc || NULL == iterator ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    if ( '{' != *container->position && '[' != *container->position )
+        return JSON_STATUS_INVALID_PARAMETERS;
+    return init_iterator( container, iterator );
+}
+
+extern json_status_t json_ondemand_iterate_object_member(
+                                        json_ondemand_iterator_t *iterator,
+                                        const unsigned char **name,
+                                        json_ondemand_value_t *member )
+{
+    if ( NULL == iterator || NULL == member || '}' != iterator->close ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    json_ondemand_doc_t *doc = iterator->doc;
+    start_access( doc );
+
+    json_status_t status = next_item( iterator );
+    if ( JSON_STATUS_SUCCESS != status ) return status;
+
+    release_member_name( doc );     // the previous one is not valid anymore
+    doc->lex.ptr = iterator->position + 1;
+    unsigned char *decoded = json_lex_string( &doc->lex, doc->lex.name_buffer,
+                                              NAME_BUFFER_SIZE );
+    if ( NULL == decoded ) return text_error( doc, doc->lex.ptr );
+    if ( decoded != doc->lex.name_buffer ) doc->name = decoded;
+
+    status = member_value( iterator, doc->lex.ptr );
+    if ( JSON_STATUS_SUCCESS != status ) return status;
+
+    if ( name ) *name = decoded;
+    set_value( member, iterator );
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_status_t json_ondemand_iterate_array_element(
+                                        json_ondemand_iterator_t *iterator,
+                                        json_ondemand_value_t *element )
+{
+    if ( NULL == iterator || NULL == element || ']' != iterator->close ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    start_access( iterator->doc );
+
+    json_status_t status = next_item( iterator );
+    if ( JSON_STATUS_SUCCESS != status ) return status;
+
+    set_value( element, iterator );
+    return JSON_STATUS_SUCCESS;
+}
+
+/*  -----------------------------------------------------------------
+    reading values, with the same rules as the parser
+    -----------------------------------------------------------------  */
+
+// a scalar must be followed by a blank, a structural character or the end
+static json_status_t check_scalar_end( json_ondemand_doc_t *doc )
+{
+    const unsigned char *p = doc->lex.ptr;
+    if ( p < doc->lex.end && ! is_delimiter( *p ) )
+        return syntax_error( doc, p, "after value" );
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_status_t json_ondemand_get_boolean_value(
+                                        const json_ondemand_value_t *value,
+                                        bool *boolean )
+{
+    if ( NULL == value || NULL == value->doc || NULL == boolean ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    bool is_true = ( 't' == *value->position );
+    if ( ! is_true && 'f' != *value->position )
+        return JSON_STATUS_INVALID_PARAMETERS;
+
+    json_ondemand_doc_t *doc = value->doc;
+    start_access( doc );
+    doc->lex.ptr = value->position + 1;
+    if ( ! json_lex_literal( &doc->lex, (const unsigned char *)
+                                        ( ( is_true ) ? "true" : "false" ) ) )
+        return text_error( doc, doc->lex.ptr - 1 );
+
+    json_status_t status = check_scalar_end( doc );
+    if ( JSON_STATUS_SUCCESS == status ) *boolean = is_true;
+    return status;
+}
+
+static json_status_t read_number( const json_ondemand_value_t *value,
+                                  number_t *number )
+{
+    if ( JSON_NUMBER != json_ondemand_get_value_type( value ) )
+        return JSON_STATUS_INVALID_PARAMETERS;
+
+    json_ondemand_doc_t *doc = value->doc;
+    start_access( doc );
+    doc->lex.ptr = value->position;
+    if ( ! json_lex_number( &doc->lex, number ) )
+        return text_error( doc, doc->lex.ptr );
+    return check_scalar_end( doc );
+}
+
+extern json_status_t json_ondemand_get_integer_value(
+                                        const json_ondemand_value_t *value,
+                                        long long int *integer )
+{
+    if ( NULL == value || NULL == value->doc || NULL == integer ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    number_t number;
+    json_status_t status = read_number( value, &number );
+    if ( JSON_STATUS_SUCCESS != status ) return status;
+    if ( JSON_INTEGER_NUMBER != number.ntype )
+        return JSON_STATUS_INVALID_PARAMETERS;
+
+    *integer = number.ndata.integer;
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_status_t json_ondemand_get_real_value(
+                                        const json_ondemand_value_t *value,
+                                        double *real )
+{
+    if ( NULL == value || NULL == value->doc || NULL == real ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    number_t number;
+    json_status_t status = read_number( value, &number );
+    if ( JSON_STATUS_SUCCESS != status ) return status;
+
+    *real = ( JSON_INTEGER_NUMBER == number.ntype ) ?
+                                        (double)number.ndata.integer :
+                                        number.ndata.real;
+    return JSON_STATUS_SUCCESS;
+}
+
+extern json_status_t json_ondemand_get_string_value(
+                                        const json_ondemand_value_t *value,
+                                        unsigned char **string )
+{
+    if ( NULL == value || NULL == value->doc || NULL == string ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return JSON_STATUS_INVALID_PARAMETERS;
+    }
+    if ( '"' != *value->position ) return JSON_STATUS_INVALID_PARAMETERS;
+
+    json_ondemand_doc_t *doc = value->doc;
+    start_access( doc );
+    doc->lex.ptr = value->position + 1;
+    unsigned char *decoded = json_lex_string( &doc->lex, NULL, 0 );
+    if ( NULL == decoded ) return text_error( doc, doc->lex.ptr );
+
+    *string = decoded;
+    return JSON_STATUS_SUCCESS;
+}
@@ -0,0 +1,119 @@
+
+#ifndef __JSONONDEMAND_H__
+#define __JSONONDEMAND_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "jsonvalue.h"
+#include "jsonparse.h"
+
+/* On-demand access to a json document in memory.
+
+   No tree is built: a value is just a cursor on its first character in the
+   text, and the text is read only when a value is accessed. Searching for a
+   member or an element reads the container up to that member or element,
+   and the values that are skipped on the way are only bracket-matched: they
+   are not checked. A string, number or literal is checked and converted only
+   when its value is requested, with exactly the same rules as the tree
+   parser (json_parse_buffer_n). Comments are not accepted.
+
+   This is useful to extract a few values from large documents. As a
+   consequence, an invalid document may not be detected as such.
+
+   The buffer must remain available and unchanged until the document is
+   freed. Cursors and iterators are small structures that are copied as
+   needed and never freed. They are valid until the document is freed.
+
+   Access functions return JSON_STATUS_SUCCESS or an error status. In case of
+   a syntax error in the text, the error string can be retrieved with
+   json_ondemand_get_error_report. */
+
+typedef struct _json_ondemand_doc json_ondemand_doc_t;
+
+typedef struct {
+    json_ondemand_doc_t     *doc;
+    const unsigned char     *position;  // value first character
+} json_ondemand_value_t;
+
+/* create a document from len bytes of json text, and return NULL if memory
+   cannot be allocated. The text is not read until it is accessed */
+extern json_ondemand_doc_t *json_ondemand_new_doc( const unsigned char *buffer,
+                                                   size_t len );
+
+extern void json_ondemand_free_doc( json_ondemand_doc_t *doc );
+
+/* fill the error report from the last access that failed. As with the
+   parser, the error string is allocated on the heap and must be freed */
+extern void json_ondemand_get_error_report( const json_ondemand_doc_t *doc,
+                                            json_error_report_t *error );
+
+/* get the document root value. Nothing after the root value is read */
+extern json_status_t json_ondemand_get_root( json_ondemand_doc_t *doc,
+                                             json_ondemand_value_t *root );
+
+/* return the type of a value, from its first character only (so that an
+   invalid value may still be reported as a valid type) */
+extern json_value_type_t json_ondemand_get_value_type(
+                                        const json_ondemand_value_t *value );
+
+/* read a scalar value. If the value is not of the requested type, the
+   status JSON_STATUS_INVALID_PARAMETERS is returned. An integer value can be
+   read as a real, but a real value cannot be read as an integer */
+extern json_status_t json_ondemand_get_boolean_value(
+                                        const json_ondemand_value_t *value,
+                                        bool *boolean );
+extern json_status_t json_ondemand_get_integer_value(
+                                        const json_ondemand_value_t *value,
+                                        long long int *integer );
+extern json_status_t json_ondemand_get_real_value(
+                                        const json_ondemand_value_t *value,
+                                        double *real );
+
+/* read a string value (zero-terminated UTF8 string). The string is decoded
+   in a copy allocated in the heap, which must be freed after use */
+extern json_status_t json_ondemand_get_string_value(
+                                        const json_ondemand_value_t *value,
+                                        unsigned char **string );
+
+/* search for the first member with the given name in an object. Return
+   JSON_STATUS_NOT_A_MEMBER if there is no such member, or
+   JSON_STATUS_NOT_AN_OBJECT if the value is not an object */
+extern json_status_t json_ondemand_search_for_object_member_by_name(
+                                        const json_ondemand_value_t *object,
+                                        const unsigned char *name,
+                                        json_ondemand_value_t *member );
+
+/* get the element at index in an array. Return JSON_STATUS_OUT_OF_BOUND if
+   there is no such element, or JSON_STATUS_NOT_AN_ARRAY if the value is not
+   an array */
+extern json_status_t json_ondemand_get_array_element(
+                                        const json_ondemand_value_t *array,
+                                        size_t index,
+                                        json_ondemand_value_t *element );
+
+/* iterators over object members or array elements, in the text order. The
+   iteration returns JSON_STATUS_OUT_OF_BOUND after the last member or
+   element. The member name returned by json_ondemand_iterate_object_member
+   is stored in the document, and it is valid only until the next call for
+   the same document. */
+typedef struct {
+    json_ondemand_doc_t     *doc;
+    const unsigned char     *position;  // last member or element value
+    unsigned char           close;      // '}' or ']'
+    bool                    first;      // position is after '{' or '['
+} json_ondemand_iterator_t;
+
+extern json_status_t json_ondemand_new_iterator(
+                                        const json_ondemand_value_t *container,
+                                        json_ondemand_iterator_t *iterator );
+
+extern json_status_t json_ondemand_iterate_object_member(
+                                        json_ondemand_iterator_t *iterator,
+                                        const unsigned char **name,
+                                        json_ondemand_value_t *member );
+
+extern json_status_t json_ondemand_iterate_array_element(
+                                        json_ondemand_iterator_t *iterator,
+                                        json_ondemand_value_t *element );
+
+#endif /* __JSONONDEMAND_H__ */
@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "jsonparallel.h"
+#include "jsondata.h"
+#include "jsonlex.h"
+#include "jsonscan.h"
+
+/*  -----------------------------------------------------------------
+    parallel parsing of a root array
+    -----------------------------------------------------------------  */
+
+#define PARALLEL_MIN_SIZE   ( 1024 * 1024 ) // smaller texts are not split
+#define PARTS_PER_THREAD    4               // for load balancing
+
+typedef struct {
+    const unsigned char *start;         // first element in part
+    const unsigned char *end;           // following ',' or root ']'
+    array_t             *array;         // NULL in case of error
+} part_t;
+
+typedef struct {
+    part_t              *parts;
+    size_t              nb_parts;
+    size_t              next_part;      // next part to parse
+    bool                comments;
+    bool                failed;         // stop parsing parts
+    pthread_mutex_t     lock;
+} parallel_ctxt_t;
+
+/* Locate the ',' between the root array elements, about every step bytes,
+   and fill the parts in between. Return the number of parts, or 0 if the
+   text cannot be split: it is then parsed in sequence, which reports the
+   errors if it is not valid. Only strings and brackets are recognized, the
+   parts are checked when they are parsed. */
+static size_t split_root_array( const unsigned char *buffer, size_t len,
+                                part_t *parts, size_t max_parts )
+{
+    const unsigned char *end = buffer + len;
+    const unsigned char *p = json_skip_blank_span( buffer, end );
+    if ( p == end || '[' != *p ) return 0;
+
+    size_t step = len / max_parts, nb_parts = 0;
+    parts[0].start = ++p;
+    const unsigned char *next_split = p + step;
+    unsigned int depth = 1;
+    bool non_ascii;
+
+    for ( ; p < end; ++p ) {
+        switch ( *p ) {
+        case '"':
+            while ( true ) {
+                p = json_scan_string_span( p + 1, end, &non_ascii );
+                if ( p == end ) return 0;
+                if ( '"' == *p ) break;
+                if ( '\\' == *p && ++p == end ) return 0;
+            }
+            break;
+        case '[': case '{':
+            ++depth;
+            break;
+        case ']': case '}':
+            if ( 0 == --depth ) {
+                if ( ']' != *p ||
+                     end != json_skip_blank_span( p + 1, end ) )
+                    return 0;
+                parts[nb_parts++].end = p;
+                return nb_parts;
+            }
+            break;
+        case ',':
+            if ( 1 == depth && p >= next_split && nb_parts < max_parts - 1 ) {
+                parts[nb_parts++].end = p;
+                parts[nb_parts].start = p + 1;
+                next_split = p + step;
+            }
+            break;
+        case '/':           // comments are not split
+            return 0;
+        default:
+            break;
+        }
+    }
+    return 0;
+}
+
+static void parse_part( part_t *part, bool comments )
+{
+    json_parse_ctxt_t ctxt;
+    json_lex_init_buffer( &ctxt, part->start, part->end - part->start,
+                          comments );
+    ctxt.open_stack = 1;            // inside the root array
+    part->array = new_array( NULL );
+    if ( part->array )
+        part->array = json_parse_elements( &ctxt, part->array );
+}
+
+static void *parse_parts( void *arg )
+{
+    parallel_ctxt_t *ctxt = arg;
+    while ( true ) {
+        pthread_mutex_lock( &ctxt->lock );
+        size_t index = ctxt->next_part++;
+        bool failed = ctxt->failed;
+        pthread_mutex_unlock( &ctxt->lock );
+        if ( failed || index >= ctxt->nb_parts ) break;
+
+        part_t *part = &ctxt->parts[index];
+        parse_part( part, ctxt->comments );
+        if ( NULL == part->array ) {
+            pthread_mutex_lock( &ctxt->lock );
+            ctxt->failed = true;
+            pthread_mutex_unlock( &ctxt->lock );
+        }
+    }
+    return NULL;
+}
+
+/* parse the parts with nthreads threads, including the calling thread, and
+   return the root array, or NULL in case of error */
+static array_t *parse_in_parallel( parallel_ctxt_t *ctxt, unsigned int nthreads )
+{
+    pthread_t *threads = malloc( nthreads * sizeof( pthread_t ) );
+    if ( NULL == threads ) return NULL;
+
+    pthread_mutex_init( &ctxt->lock, NULL );
+    unsigned int nb_started = 0;
+    while ( nb_started < nthreads - 1 &&
+            0 == pthread_create( &threads[nb_started], NULL, parse_parts, ctxt ) )
+        ++nb_started;
+    parse_parts( ctxt );
+    for ( unsigned int i = 0; i < nb_started; ++i )
+        pthread_join( threads[i], NULL );
+    pthread_mutex_destroy( &ctxt->lock );
+    free( threads );
+
+    array_t *array = NULL;
+    for ( size_t i = 0; i < ctxt->nb_parts; ++i ) {
+        array_t *part_array = ctxt->parts[i].array;
+        if ( ctxt->failed || NULL == part_array ) {
+            json_free_array( part_array );  // parts may not have been parsed
+        } else if ( NULL == array ) {
+            array = part_array;
+        } else {
+            array = array_join( array, part_array );
+            if ( NULL == array ) ctxt->failed = true;
+        }
+    }
+    if ( ctxt->failed ) {
+        json_free_array( array );
+        return NULL;
+    }
+    return array;
+}
+
+extern json_value_t *json_parse_buffer_parallel( const unsigned char *buffer,
+                                                 size_t len, bool comments,
+                                                 unsigned int nthreads,
+                                                 json_error_report_t *error )
+{
+    if ( 0 == nthreads ) {
+        long nb_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        nthreads = ( nb_cpus > 0 ) ? (unsigned int)nb_cpus : 1;
+    }
+    if ( nthreads < 2 || NULL == buffer || len < PARALLEL_MIN_SIZE )
+        return json_parse_buffer_n( buffer, len, comments, error );
+
+    parallel_ctxt_t ctxt;
+    size_t max_parts = (size_t)nthreads * PARTS_PER_THREAD;
+    ctxt.parts = calloc( max_parts, sizeof( part_t ) );
+    ctxt.nb_parts = ( ctxt.parts ) ?
+                    split_root_array( buffer, len, ctxt.parts, max_parts ) : 0;
+    ctxt.next_part = 0;
+    ctxt.comments = comments;
+    ctxt.failed = false;
+
+    json_value_t *value = NULL;
+    array_t *array = ( ctxt.nb_parts > 1 ) ?
+                     parse_in_parallel( &ctxt, nthreads ) : NULL;
+    free( ctxt.parts );
+    if ( array ) {
+        value = malloc( sizeof( json_value_t ) );
+        if ( NULL == value ) json_free_array( array );
+    }
+    if ( NULL == value )    // also reports the first error in the text
+        return json_parse_buffer_n( buffer, len, comments, error );
+
+    value->vtype = JSON_ARRAY;
+    value->vflags = 0;
+    value->vdata.array = array;
+    if ( error ) {
+        error->status = JSON_STATUS_SUCCESS;
+        error->offset = 0;
+        error->error_string = NULL;
+    }
+    return value;
+}
@@ -0,0 +1,33 @@
+
+#ifndef __JSONPARALLEL_H__
+#define __JSONPARALLEL_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "jsonvalue.h"
+#include "jsonparse.h"
+
+/* Parallel parsing of a single large document in memory.
+
+   Large documents are usually made of a huge root array. In that case, the
+   text is first scanned quickly, without parsing, to locate the ',' between
+   the root array elements, and the elements are divided into parts of about
+   the same size, which are parsed by several threads. The parts are finally
+   joined into the same root array.
+
+   The result is exactly the same as with json_parse_buffer_n, as well as the
+   errors, since an invalid document is parsed again in sequence to report
+   the first error in the text. Documents that are not arrays, small
+   documents and documents with comments are always parsed in sequence. */
+
+/* parse the len bytes of json text in buffer, with nthreads threads (if
+   nthreads is 0, one per online processor, and if it is 1, the text is
+   parsed in the calling thread), accepting C/C++ comments only if the
+   argument comments is true. The returned value and errors are the same as
+   with json_parse_buffer_n. */
+extern json_value_t *json_parse_buffer_parallel( const unsigned char *buffer,
+                                                 size_t len, bool comments,
+                                                 unsigned int nthreads,
+                                                 json_error_report_t *error );
+
+#endif /* __JSONPARALLEL_H__ */
@@ -1,4 +1,5 @@
 
+#define _DEFAULT_SOURCE             // for MAP_POPULATE & MADV_SEQUENTIAL
 #include <stdio.h>
 #include <assert.h>
 #include <ctype.h>
@@ -8,47 +9,196 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include "jsonparse.h"
 #include "jsondata.h"
 #include "jsonvalue.h"
 #include "jsonutf8.h"
+#include "jsonscan.h"
+#include "jsonarena.h"
+#include "jsonkey.h"
+#include "jsonlex.h"
 
 /*  -------------------------------------------------------------------
     simple C JSON parser
     -------------------------------------------------------------------  */
 
-#define MAX_ERROR_STRING_LENGTH  512
-typedef struct {
-    json_source_t         source;          // for file, pipe or terminal sources
+/* the parsing context json_parse_ctxt_t is defined in jsonlex.h */
 
-    struct _string_buffer *head, *current; // for string buffering only
+/* Characters are read either directly from a memory buffer, through a raw
+   cursor and an end pointer, or by calling the source get function if no
+   memory buffer was given (in which case ptr and end are both NULL). A block
+   source is read as a sequence of memory buffers: the source get function is
+   not set and once the block source is exhausted its refill function is
+   reset, so that its end is handled as the end of a memory buffer.
 
-    bool                  comments;        // comments accepted
-    unsigned int          line;            // current line
-    json_status_t         ecode;           // error code & error string below
-    char                  estring[MAX_ERROR_STRING_LENGTH];
+   At most 2 characters are pushed back, for instance '/' and the following
+   character, which may be the first one of a block. The last character of
+   the previous block is then read from a copy, before the current block.
 
-    unsigned int          open_stack;      // limits stack usage against DOS attack
+   The lines of a block are counted when the next block is read, except for
+   its last character, which is counted only once the cursor is past it. */
+extern void json_lex_end_block( json_parse_ctxt_t *ctxt,
+                                const unsigned char *start,
+                                const unsigned char *end )
+{
+    if ( start == end ) return;
+    if ( 0x0a == ctxt->last ) {     // last char of the previous block
+        ++ctxt->lines;
+        ctxt->line_start = ctxt->base;
+    }
+    const unsigned char *ptr = start;
+    while ( ptr < end - 1 &&
+            NULL != ( ptr = memchr( ptr, 0x0a, (size_t)( end - 1 - ptr ) ) ) ) {
+        ++ctxt->lines;
+        ctxt->line_start = ctxt->base + (size_t)( ++ptr - start );
+    }
+    ctxt->last = end[-1];
+    ctxt->base += (size_t)( end - start );
+}
 
-} json_parse_ctxt_t;
+static int refill_next_char( json_parse_ctxt_t *ctxt )
+{
+    if ( ctxt->end == &ctxt->last + 1 ) {   // back to the current block
+        ctxt->ptr = ctxt->block;
+        ctxt->end = ctxt->block_end;
+        return *ctxt->ptr++;
+    }
+    if ( ctxt->block ) json_lex_end_block( ctxt, ctxt->block, ctxt->block_end );
+
+    const unsigned char *block = NULL;
+    size_t len = ctxt->blocks.refill( &ctxt->blocks, &block );
+    if ( 0 == len ) {
+        ctxt->blocks.refill = NULL; // not called again
+        ctxt->block = ctxt->block_end = ctxt->ptr = ctxt->end = NULL;
+        ctxt->start = NULL;
+        ctxt->at_end = true;
+        return EOF;
+    }
+    ctxt->start = ctxt->block = ctxt->ptr = block;
+    ctxt->block_end = ctxt->end = block + len;
+    return *ctxt->ptr++;
+}
 
-static void error_report( json_parse_ctxt_t *ctxt, json_status_t code, const char *fmt, ... )
+/* A source read one character at a time is counted the same way, as if each
+   character was a block: its position is the number of characters read. */
+static int get_source_char( json_parse_ctxt_t *ctxt )
 {
-  va_list ap;
+    int c = ctxt->source.get( &ctxt->source );
+    if ( EOF == c ) {
+        ctxt->at_end = true;
+        return EOF;
+    }
+    if ( 0x0a == ctxt->last ) {
+        ++ctxt->lines;
+        ctxt->line_start = ctxt->base;
+    }
+    ctxt->last = (unsigned char)c;
+    ++ctxt->base;
+    return c;
+}
+
+static inline int get_next_char( json_parse_ctxt_t *ctxt )
+{
+    if ( ctxt->ptr < ctxt->end )
+        return *ctxt->ptr++;
+    if ( ctxt->blocks.refill )
+        return refill_next_char( ctxt );
+    if ( NULL == ctxt->source.get ) {
+        ctxt->at_end = true;
+        return EOF;                 // end of memory buffer
+    }
+    return get_source_char( ctxt );
+}
+
+static inline void push_back_char( json_parse_ctxt_t *ctxt, int c )
+{
+    if ( EOF == c ) return;
+    if ( NULL == ctxt->source.get ) {
+        if ( ctxt->ptr == ctxt->block ) {   // c is from the previous block
+            assert( c == ctxt->last );
+            ctxt->ptr = &ctxt->last;
+            ctxt->end = &ctxt->last + 1;
+        } else {
+            --ctxt->ptr;            // only the last read char is pushed back
+        }
+    } else {
+        ctxt->source.push_back( &ctxt->source, c );
+        --ctxt->base;
+        ctxt->last = 0;             // the previous character was counted
+    }
+}
+
+/* Return the offset of the last character read, or the number of characters
+   read if the end of text was reached. */
+static size_t read_offset( const json_parse_ctxt_t *ctxt )
+{
+    size_t offset;
+    if ( ctxt->ptr == &ctxt->last || ctxt->ptr == &ctxt->last + 1 )
+        offset = ctxt->base - (size_t)( &ctxt->last + 1 - ctxt->ptr );
+    else if ( ctxt->ptr && ctxt->start )
+        offset = ctxt->base + (size_t)( ctxt->ptr - ctxt->start );
+    else
+        offset = ctxt->base;        // source read by char, or end of blocks
 
-  int next = snprintf( ctxt->estring, MAX_ERROR_STRING_LENGTH,
-                       "json_parse: line %d: ", ctxt->line );
+    if ( ! ctxt->at_end && offset > 0 ) --offset;
+    return offset;
+}
+
+/* Format the error position at offset, in the buffer or block start, which
+   begins at ctxt->base, as the error string prefix. Lines are counted only
+   now, from the start of the buffer or block. */
+static int error_position( json_parse_ctxt_t *ctxt, const unsigned char *start,
+                           size_t offset, char *prefix, size_t size )
+{
+    unsigned int line = 1 + ctxt->lines;
+    size_t line_start = ctxt->line_start;
+
+    if ( offset >= ctxt->base ) {
+        if ( 0x0a == ctxt->last ) {
+            ++line;
+            line_start = ctxt->base;
+        }
+        if ( start ) {
+            const unsigned char *ptr = start, *end = start + offset - ctxt->base;
+            while ( ptr < end &&
+                    NULL != ( ptr = memchr( ptr, 0x0a, (size_t)( end - ptr ) ) ) ) {
+                ++line;
+                line_start = ctxt->base + (size_t)( ++ptr - start );
+            }
+        }
+    }
+    size_t column = ( offset >= line_start ) ? 1 + offset - line_start : 1;
+    ctxt->eoffset = offset;
+    return snprintf( prefix, size, "json_parse: line %u, column %zu: ",
+                     line, column );
+}
+
+static void error_report_va( json_parse_ctxt_t *ctxt, json_status_t code,
+                             const char *fmt, va_list ap )
+{
+  int next = error_position( ctxt, ctxt->start, read_offset( ctxt ),
+                             ctxt->estring, MAX_ERROR_STRING_LENGTH );
   assert( next < MAX_ERROR_STRING_LENGTH );
 
-  va_start(ap, fmt );
+  ctxt->eprefix = (unsigned int)next;
   vsnprintf( &ctxt->estring[next], MAX_ERROR_STRING_LENGTH-next,
              fmt, ap );
-  va_end( ap );
   ctxt->ecode = code;
 }
 
+static void error_report( json_parse_ctxt_t *ctxt, json_status_t code, const char *fmt, ... )
+{
+  va_list ap;
+
+  va_start(ap, fmt );
+  error_report_va( ctxt, code, fmt, ap );
+  va_end( ap );
+}
+
 static void wrong_char_error_report( json_parse_ctxt_t *ctxt, const char *specific, int c )
 {
     if ( EOF == c )
@@ -63,8 +213,8 @@ static bool skip_cpp_comment( json_parse_ctxt_t *ctxt )
 {
     while ( 1 ) {             // loop till end of line (0x0a)
         int c;
-        bool escaped;
-        while ( 0x0a != ( c = ctxt->source.get( &ctxt->source ) ) ) {
+        bool escaped = false;
+        while ( 0x0a != ( c = get_next_char( ctxt ) ) ) {
             escaped = false;
             if ( '\\' == c ) { // next char is escaped
                 escaped = true;
@@ -72,7 +222,6 @@ static bool skip_cpp_comment( json_parse_ctxt_t *ctxt )
             }
             if ( EOF == c ) return true;
         }
-        ++ctxt->line;        // increment line count
         if ( ! escaped ) {   // 0x0a was not escaped
             break;           // exit end of line loop
         }
@@ -82,24 +231,21 @@ static bool skip_cpp_comment( json_parse_ctxt_t *ctxt )
 
 static bool skip_c_comment( json_parse_ctxt_t *ctxt )
 {
+    bool escaped = false;    // kept when '*' is followed by '*'
     while ( 1 ) {            // loop till '*'
         int c;
-        bool escaped;
-        while( '*' != ( c = ctxt->source.get( &ctxt->source ) ) ) {
+        while( '*' != ( c = get_next_char( ctxt ) ) ) {
             escaped = false;
             if ( '\\' == c ) { // next char is escaped
                 escaped = true;
                 continue;
             }
             if ( EOF == c ) return true;
-
-            if ( 0x0a == c )
-                ++ctxt->line; // increment line count
         }
-        c = ctxt->source.get( &ctxt->source );
+        c = get_next_char( ctxt );
         if ( ! escaped && '/' == c )
             break;           // exit if unescaped '*' and followed by '/'
-        ctxt->source.push_back( &ctxt->source, c );
+        push_back_char( ctxt, c );
     }
     return false;             // skip '/' following unescaped '*'
 }
@@ -107,16 +253,17 @@ static bool skip_c_comment( json_parse_ctxt_t *ctxt )
 static int skip_blank( json_parse_ctxt_t *ctxt )
 {
     int c;
-    //const unsigned char *ptr = ctxt->ptr;
-    while ( ( c = ctxt->source.get( &ctxt->source ) ) ) {
+    while ( ( c = get_next_char( ctxt ) ) ) {
         switch( c ) {
-        case 0x0a: /* LF */
-            ++ctxt->line;
-        case 0x09: /* tab */ case 0x0d: /* CR */ case 0x20: /* space */
+        case 0x09: /* tab */ case 0x0a: /* LF */
+        case 0x0d: /* CR */  case 0x20: /* space */
+            // in memory, skip the following blanks many bytes at a time
+            if ( ctxt->ptr < ctxt->end && *ctxt->ptr <= 0x20 )
+                ctxt->ptr = json_skip_blank_span( ctxt->ptr, ctxt->end );
             continue;
         case '/':
             if ( ctxt->comments ) {
-                int c1 = ctxt->source.get( &ctxt->source );
+                int c1 = get_next_char( ctxt );
                 if ( '/' == c1 ) {          // C++ // comment, till end of line
                     if ( skip_cpp_comment( ctxt ) ) return EOF;
                     continue;
@@ -125,7 +272,7 @@ static int skip_blank( json_parse_ctxt_t *ctxt )
                     if ( skip_c_comment( ctxt ) ) return EOF;
                     continue;
                 }
-                ctxt->source.push_back( &ctxt->source, c1 ); // push '/' or '*' back
+                push_back_char( ctxt, c1 ); // push '/' or '*' back
                 // the previous '/' will generate an error in caller
             }
             break;
@@ -222,7 +369,7 @@ e
 
 */
 
-static ucs4_t encode_4hex_in_ucs4( unsigned char *ptr )
+static ucs4_t encode_4hex_in_ucs4( const unsigned char *ptr )
 {
     ucs4_t res = 0;
 
@@ -320,7 +467,7 @@ static int get_string_data( json_data_input_t *data_input )
         c = string_ctxt->first_char;
         string_ctxt->first_char = -1;
     } else {
-        c = ctxt->source.get( &ctxt->source );
+        c = get_next_char( ctxt );
     }
 
     unsigned char to_store = ( EOF == c ) ? 0 : (unsigned char)c;
@@ -343,7 +490,7 @@ static inline int string_error( json_parse_ctxt_t *ctxt,
 static int read_four_hex( json_parse_ctxt_t *ctxt, unsigned char *fh )
 {
     for ( int i = 0; i < 4; ++i ) {
-        int c = ctxt->source.get( &ctxt->source ); // not buffered
+        int c = get_next_char( ctxt ); // not buffered
         if ( EOF == c )
             return string_error( ctxt, JSON_STATUS_INVALID_ENCODING,
                                  "end of file while processing \\u four-hex-digits" );
@@ -352,22 +499,29 @@ static int read_four_hex( json_parse_ctxt_t *ctxt, unsigned char *fh )
     return 0;
 }
 
-static int process_escaped_ascii_char( json_parse_ctxt_t *ctxt, unsigned char c )
+// return the character represented by the single escape char c, or -1
+static inline int unescape_ascii_char( unsigned char c )
 {
     switch( c ) {
-    default:
+    default:                                  return -1;
+    case '"': case '\\': case '/':            return c;
+    case 'b':                                 return '\b';
+    case 'f':                                 return '\f';
+    case 'n':                                 return '\n';
+    case 'r':                                 return '\r';
+    case 't':                                 return '\t';
+    }
+}
+
+static int process_escaped_ascii_char( json_parse_ctxt_t *ctxt, unsigned char c )
+{
+    int unescaped = unescape_ascii_char( c );
+    if ( -1 == unescaped ) {
        string_error( ctxt, JSON_STATUS_INVALID_STRING, "invalid escape sequence");
        return -1;
-
-    case '"': case '\\': case '/':            break;
-    case 'b':                       c = '\b'; break;
-    case 'f':                       c = '\f'; break;
-    case 'n':                       c = '\n'; break;
-    case 'r':                       c = '\r'; break;
-    case 't':                       c = '\t'; break;
     }
 
-    if ( ! buffer_source_string( &(ctxt->current), c ) )
+    if ( ! buffer_source_string( &(ctxt->current), (unsigned char)unescaped ) )
         return string_error( ctxt, JSON_STATUS_INVALID_STRING,
                             "Out of memory while parsing string" );
 
@@ -396,9 +550,9 @@ static int process_escaped_4_hex_digits( json_parse_ctxt_t *ctxt )
        So, check if a \u immediately follows (reads 2 bytes ahead) */
     int c1; // holds the single escape char if single_escape_follows is true
     if ( encoded >= 0xd800 && encoded <= 0xdbff ) {
-        int c = ctxt->source.get( &ctxt->source );
+        int c = get_next_char( ctxt );
         if ( '\\' == c ) {
-            c1 = ctxt->source.get( &ctxt->source );
+            c1 = get_next_char( ctxt );
             if ( 'u' == c1 ) { // possibly a tail surrogate
                 if ( read_four_hex( ctxt, four_hex ) )  return -1;
                 ucs4_t tail = encode_4hex_in_ucs4( four_hex );
@@ -429,10 +583,217 @@ static int process_escaped_4_hex_digits( json_parse_ctxt_t *ctxt )
     return len;
 }
 
-static unsigned char *make_string( json_parse_ctxt_t *ctxt )
+/*
+    A memory buffer can be read ahead, so that strings are processed in a
+    single pass: the string bounds are located first (checking for control
+    characters and then UTF8 encoding), then the string is allocated
+    and runs of unescaped bytes are copied directly into it, while escape
+    sequences are decoded in place. Since an escape sequence is never shorter
+    than its decoded value, the raw string length is enough for the result.
+*/
+// decode the escape sequence at *srcp (pointing to '\\') into *dstp
+static bool decode_buffer_escape( json_parse_ctxt_t *ctxt,
+                                  const unsigned char **srcp,
+                                  const unsigned char *end,
+                                  unsigned char **dstp )
+{
+    const unsigned char *src = *srcp;
+    assert( '\\' == *src && src + 1 < end );
+
+    if ( 'u' != src[1] ) {
+        int unescaped = unescape_ascii_char( src[1] );
+        if ( -1 == unescaped ) {
+            ctxt->ptr = src + 2;    // error at the escaped char
+            error_report( ctxt, JSON_STATUS_INVALID_STRING,
+                          "invalid escape sequence" );
+            return false;
+        }
+        *(*dstp)++ = (unsigned char)unescaped;
+        *srcp = src + 2;
+        return true;
+    }
+
+    if ( end - src < 6 ) {
+        ctxt->ptr = end;
+        error_report( ctxt, JSON_STATUS_INVALID_ENCODING,
+                      "end of string while processing \\u four-hex-digits" );
+        return false;
+    }
+    ucs4_t encoded = encode_4hex_in_ucs4( src + 2 );
+    if ( 0xffffffff == encoded ) {
+        ctxt->ptr = src + 6;
+        error_report( ctxt, JSON_STATUS_INVALID_ENCODING,
+                      "Invalid unicode encoding \\u four-hex-digits" );
+        return false;
+    }
+    src += 6;
+
+    // a head surrogate must be immediately followed by an escaped tail
+    if ( encoded >= 0xd800 && encoded <= 0xdbff &&
+         end - src >= 6 && '\\' == src[0] && 'u' == src[1] ) {
+        ucs4_t tail = encode_4hex_in_ucs4( src + 2 );
+        if ( tail >= 0xdc00 && tail <= 0xdfff ) {
+            encoded = ( ( encoded - 0xd800 ) << 10 ) + 0x10000;
+            encoded += tail - 0xdc00;
+            src += 6;
+        }   // else isolated head: error below
+    }
+
+    if ( json_output_utf8( encoded, dstp ) ) {
+        const unsigned char *read = src;    // as far as characters are read
+        if ( encoded >= 0xd800 && encoded <= 0xdbff ) {   // looking for a tail
+            read = src + 1;
+            if ( '\\' == src[0] ) read = ( 'u' == src[1] ) ? src + 6 : src + 2;
+        }
+        ctxt->ptr = ( read <= end ) ? read : end + 1;  // up to the '"'
+        error_report( ctxt, JSON_STATUS_INVALID_ENCODING,
+                      "Unsupported UTF8 encoding \\u four-hex-digits" );
+        return false;
+    }
+    *srcp = src;
+    return true;
+}
+
+/* returned instead of a string when strings are checked only */
+static unsigned char checked_string[1];
+
+/* The UTF8 encoding of a string in memory is checked at once. In case of
+   error, the invalid sequence is located one code point at a time, as when
+   reading characters, to give the error position. */
+typedef struct {
+    const unsigned char *ptr, *end;
+} memory_input_t;
+
+static int read_memory_byte( json_data_input_t *data_input )
+{
+    memory_input_t *memory = data_input->ctxt;
+    return ( memory->ptr < memory->end ) ? *memory->ptr++ : EOF;
+}
+
+// return the position following the last byte read in the invalid sequence
+static const unsigned char *locate_invalid_utf8( const unsigned char *ptr,
+                                                 const unsigned char *end )
+{
+    memory_input_t memory = { ptr, end };
+    json_data_input_t input = { &memory, read_memory_byte };
+    while ( memory.ptr < end ) {
+        if ( '\\' == *memory.ptr )  // escape sequences are plain ASCII
+            memory.ptr += 2;
+        else if ( 0 == json_check_utf8( &input ) )
+            break;
+    }
+    return memory.ptr;
+}
+
+static unsigned char *make_buffer_string( json_parse_ctxt_t *ctxt,
+                                          unsigned char *short_string,
+                                          size_t size )
+{
+    const unsigned char *start = ctxt->ptr, *end = ctxt->end;
+    const unsigned char *ptr = start;
+    bool escaped = false, non_ascii = false;
+
+    /* " was already removed when entering here */
+    while ( ptr < end ) {          // first locate the terminating '"'
+        ptr = json_scan_string_span( ptr, end, &non_ascii );
+        if ( ptr >= end ) break;
+
+        unsigned char c = *ptr;
+        if ( '"' == c ) break;
+        if ( c < 0x20 ) {          // should have been escaped
+            ctxt->ptr = ptr + 1;
+            error_report( ctxt, JSON_STATUS_INVALID_STRING,
+                          "non-escaped control characters" );
+            return NULL;
+        }
+        escaped = true;            // skip escaped char, decoded later
+        ptr += 2;
+    }
+    if ( ptr >= end ) {
+        if ( ctxt->blocks.refill )  // string continues in the next block
+            return NULL;
+        ctxt->ptr = end;
+        ctxt->at_end = true;
+        error_report( ctxt, JSON_STATUS_INVALID_STRING, "unterminated string");
+        return NULL;
+    }
+    /* escape sequences are plain ASCII, so that the UTF8 encoding can be
+       checked at once over the whole raw string */
+    if ( non_ascii && ! json_is_utf8_span( start, ptr - start ) ) {
+        ctxt->ptr = locate_invalid_utf8( start, end );
+        error_report( ctxt, JSON_STATUS_INVALID_ENCODING,
+                      "Invalid UTF8 encoding" );
+        return NULL;
+    }
+    if ( ctxt->check_only ) {      // escape sequences are decoded and dropped
+        const unsigned char *src = start;
+        while ( escaped && NULL != ( src = memchr( src, '\\', ptr - src ) ) ) {
+            unsigned char decoded[5], *dst = decoded;
+            if ( ! decode_buffer_escape( ctxt, &src, ptr, &dst ) )
+                return NULL;
+        }
+        ctxt->ptr = ptr + 1;       // skip terminating '"'
+        return checked_string;
+    }
+
+    unsigned char *string;         // the decoded string is never longer
+    if ( ctxt->in_situ )           // decoded in place, over the raw string
+        string = (unsigned char *)start;
+    else if ( short_string && (size_t)( ptr - start ) < size )
+        string = short_string;
+    else
+        string = arena_malloc( ctxt->arena, 1 + ( ptr - start ) );
+    if ( NULL == string ) {
+        error_report( ctxt, JSON_STATUS_INVALID_STRING,
+                      "Out of memory while allocating string");
+        return NULL;
+    }
+
+    unsigned char *dst = string;
+    if ( escaped ) {
+        const unsigned char *src = start;
+        while ( src < ptr ) {      // copy runs, decoding escapes between runs
+            const unsigned char *run_end = memchr( src, '\\', ptr - src );
+            if ( NULL == run_end ) run_end = ptr;
+
+            if ( dst != src )      // in place, dst never goes past src
+                memmove( dst, src, run_end - src );
+            dst += run_end - src;
+            if ( run_end == ptr ) break;
+
+            src = run_end;
+            if ( ! decode_buffer_escape( ctxt, &src, ptr, &dst ) ) {
+                if ( string != short_string && ! ctxt->in_situ )
+                    arena_free( ctxt->arena, string );
+                return NULL;
+            }
+        }
+    } else {
+        if ( dst != start )        // else already in place
+            memcpy( dst, start, ptr - start );
+        dst += ptr - start;
+    }
+    *dst = 0;                      // a stray escaped 0 truncates the string
+                                   // (in place, 0 replaces at most the '"')
+
+    ctxt->ptr = ptr + 1;           // skip terminating '"'
+    return string;
+}
+
+/* Return the parsed string, either stored in short_string if it is not NULL
+   and the string fits in its size bytes, or allocated otherwise */
+static unsigned char *make_string( json_parse_ctxt_t *ctxt,
+                                   unsigned char *short_string, size_t size )
 {
     assert( ctxt );
 
+    if ( NULL == ctxt->source.get ) {   // memory buffer or current block
+        unsigned char *string = make_buffer_string( ctxt, short_string, size );
+        if ( string || JSON_STATUS_SUCCESS != ctxt->ecode ||
+             NULL == ctxt->blocks.refill )
+            return string;
+    }   // else the string is read through the following blocks
+
     string_buffer_t first_block; // fortunately not a recursive function !
     first_block.next = NULL;
     first_block.ptr = first_block.buffer;
@@ -453,7 +814,9 @@ static unsigned char *make_string( json_parse_ctxt_t *ctxt )
 
     /* " was already removed when entering here */
     int c;
-    while ( EOF != ( c = ctxt->source.get( &ctxt->source ) ) ) {
+    while ( EOF != ( c = get_next_char( ctxt ) ) ) {
+        if ( ctxt->check_only )     // nothing is kept: reuse the first block
+            first_block.ptr = first_block.buffer;
         if ( backslash ) {
             int escaped_len = 0;
             escaped_len = ( 'u' == c ) ? process_escaped_4_hex_digits( ctxt )
@@ -492,6 +855,10 @@ static unsigned char *make_string( json_parse_ctxt_t *ctxt )
         string_error( ctxt, JSON_STATUS_INVALID_STRING, "unterminated string");
         return NULL;
     }
+    if ( ctxt->check_only ) {
+        ctxt->head = ctxt->current = NULL;
+        return checked_string;
+    }
 
     if ( ! buffer_source_string( &(ctxt->current), '\0' ) ) {
         string_error( ctxt, JSON_STATUS_INVALID_STRING,
@@ -499,7 +866,11 @@ static unsigned char *make_string( json_parse_ctxt_t *ctxt )
         return NULL;
     }
 
-    unsigned char *string = malloc( 1 + len );
+    unsigned char *string;
+    if ( short_string && (size_t)len < size )
+        string = short_string;
+    else
+        string = arena_malloc( ctxt->arena, 1 + len );
     if ( NULL == string ) {
         string_error( ctxt, JSON_STATUS_INVALID_STRING, "Out of memory while allocating string");
         return NULL;
@@ -522,221 +893,141 @@ static unsigned char *make_string( json_parse_ctxt_t *ctxt )
     return string;
 }
 
-static json_value_t *make_value( json_parse_ctxt_t *ctxt );
-static member_t *make_member( json_parse_ctxt_t *ctxt )
+/* Parse a member name and return its interned key. The name is decoded in
+   the context name buffer, unless it is too long, before looking it up in the
+   key table, which is created with the first member if it was not given. */
+static json_key_t *make_member_key( json_parse_ctxt_t *ctxt )
 {
-    assert( ctxt );
+    if ( NULL == ctxt->keys ) {
+        ctxt->keys = json_new_private_key_table( );
+        if ( NULL == ctxt->keys ) {
+            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                          "Out of memory while creating a key table" );
+            return NULL;
+        }
+        ctxt->own_keys = true;
+    }
 
-    /* " was already removed when entering here */
-    unsigned char *name = make_string( ctxt );
+    /* the name is copied into the key, so it is allocated in heap if long */
+    json_arena_t *arena = ctxt->arena;
+    ctxt->arena = NULL;
+    unsigned char *name = make_string( ctxt, ctxt->name_buffer,
+                                       NAME_BUFFER_SIZE );
+    ctxt->arena = arena;
     if ( NULL == name ) return NULL;
 
-    json_value_t *value = NULL;
-    int c = skip_blank( ctxt );
-
-    if ( ':' != c ) {
-        error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
-            "Syntax error (missing ':') while expecting \"name\" : value" );
-        free( name );
-        return NULL;
-    }
-    value = make_value( ctxt );
-    if ( NULL == value ) {
+    size_t length = strlen( (const char *)name );
+    json_key_t *key = json_intern_key( ctxt->keys, arena, name, length );
+    if ( name != ctxt->name_buffer && ! ctxt->in_situ )
         free( name );
-        return NULL;
-    }
-    member_t *member = new_member( name, value );
-    if ( NULL == member ) { // name has already been freed
-        json_free( value );
-    }
-    return member;
-}
-
-static object_t *make_object( json_parse_ctxt_t *ctxt )
-{
-    assert( ctxt );
-
-    object_t *object = new_object( );
-#ifdef _JSON_FAST_ACCESS_LARGER_CODE
-    if( NULL == object ) {
+    if ( NULL == key ) {
         error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                               "Out of memory while creating an object" );
-        return NULL;
-    }
-#endif
-    member_t *last_member = NULL;
-    int c = skip_blank( ctxt );    // { was already removed when entering here
-
-    if ( '}' == c ) return object; // empty object is ok
-
-#if ACCEPT_LAST_COMMA
-    while ( '}' != c ) {
-#else
-    while ( true ) {
-#endif
-        if ( '"' == c ) {
-            member_t *member = make_member( ctxt );
-            if ( NULL == member ) {
-                json_free_object(object);
-                return NULL;
-            }
-
-            object = object_attach_member( object, member, &last_member );
-            if( NULL == object ) {
-                error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                               "Out of memory while extending an object" );
-                json_free_object(object);
-                return NULL;
-            }
-
-            c = skip_blank( ctxt );
-            if ( ',' == c ) {
-                c = skip_blank( ctxt );
-                continue;
-            } else if ( '}' == c )
-                break;
-        }
-        wrong_char_error_report( ctxt, "while expecting object member", c );
-        json_free_object(object);
-        return NULL;
+                      "Out of memory while interning a member name" );
     }
-    return object;
+    return key;
 }
 
-static element_t *make_element( json_parse_ctxt_t *ctxt )
-{
-    json_value_t *value = make_value( ctxt );
-    if ( NULL == value )
-        return NULL;
-    element_t *element = new_element( value );
-    if ( NULL == element ) { // value was already freed
-        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                                "Out of memory while creating an element" );
-    }
-    return element;
-}
+/*
+    Numbers are parsed into a decimal form: sign, integer mantissa (up to 19
+    significant digits, which always fit in 64 bits) and decimal exponent.
+    Integers that can be represented exactly are converted directly, without
+    going through a double, so that no precision is lost up to 64 bits.
+
+    Other numbers are converted to double. If the mantissa and the exponent
+    are both exactly representable as doubles, a single multiplication or
+    division gives the correctly rounded result (Clinger's fast path).
+    Otherwise all significant digits are passed to strtod, without decimal
+    point so that the conversion does not depend on the current locale.
+*/
+#define MAX_MANTISSA_DIGITS     19      // always fit in uint64_t
+#define MAX_DECIMAL_DIGITS      800     // enough for a correct rounding
+#define MAX_DECIMAL_EXPONENT    100000  // saturation, well beyond range
 
-static array_t *make_array( json_parse_ctxt_t *ctxt )
+typedef struct {
+    uint64_t     mantissa;              // first significant digits
+    int          exponent;              // decimal exponent of mantissa
+    unsigned int nb_digits;             // number of significant digits
+    bool         negative;
+    bool         truncated;             // non-zero digits beyond mantissa
+
+    int          text_exponent;         // decimal exponent of text
+    unsigned int text_length;           // number of digits in text
+    bool         sticky;                // non-zero digits beyond text
+    char         text[ MAX_DECIMAL_DIGITS + 16 ]; // + sticky, exponent, 0
+} decimal_number_t;
+
+static inline void add_decimal_digit( decimal_number_t *dec, int c,
+                                      bool fraction )
 {
-    assert( ctxt );
-
-    array_t *array = new_array( );
-#ifdef _JSON_FAST_ACCESS_LARGER_CODE
-    if( NULL == array ) {
-        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                                  "Out of memory while creating an array" );
-        return NULL;
+    unsigned int digit = c - '0';
+    if ( 0 == dec->nb_digits && 0 == digit ) { // leading zero in fraction
+        --dec->exponent;
+        --dec->text_exponent;
+        return;
     }
-#endif
-    element_t *last_element = NULL;
-    int c = skip_blank( ctxt );   // [ was already removed when entering here
-    if ( ']' == c ) return array; // empty array is ok
-
-#if ACCEPT_LAST_COMMA
-    while ( ']' != c ) {
-#else
-    while ( true ) {
-#endif
-        ctxt->source.push_back( &ctxt->source, c ); // backtrack 1 character for make_value
-        element_t *element = make_element( ctxt );
-        if ( NULL == element ) {
-            json_free_array( array );
-            return NULL;
-        }
-
-        array = array_append_element( array, element, &last_element );
-        if( NULL == array ) {  // array was freed in case of error
-            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                                  "Out of memory while extending an array" );
-            return NULL;
-        }
 
-        c = skip_blank( ctxt );
-        if ( ',' == c ) {
-            c = skip_blank( ctxt );
-            continue;
-        } else if ( ']' == c )
-            break;
+    if ( dec->nb_digits < MAX_MANTISSA_DIGITS ) {
+        dec->mantissa = 10 * dec->mantissa + digit;
+        if ( fraction ) --dec->exponent;
+    } else {
+        if ( digit ) dec->truncated = true;
+        if ( ! fraction ) ++dec->exponent;
+    }
+    ++dec->nb_digits;
 
-        wrong_char_error_report( ctxt, "while expecting ',' or ']'", c );
-        json_free_array( array );
-        return NULL;
+    if ( dec->text_length < MAX_DECIMAL_DIGITS ) {
+        dec->text[ dec->text_length++ ] = (char)c;
+        if ( fraction ) --dec->text_exponent;
+    } else {
+        if ( digit ) dec->sticky = true;
+        if ( ! fraction ) ++dec->text_exponent;
     }
-    return array;
 }
 
-static bool normalize_ecma_404_num( json_parse_ctxt_t *ctxt, char *buffer )
+static bool parse_ecma_404_num( json_parse_ctxt_t *ctxt, decimal_number_t *dec )
 {
-    bool integer_part = false;
-
-    /* The maximum double mantissa representable is 9,007,199,254,740,992
-       So we need to keep track of at least 17 digits for the mantissa.
-       The maximum douuble exponent is +308, the minimum is -308.
-       The normalized form is x.xxxxxxxxxxxxxxxx eyyy
-       Therefore we need at worst 3 (-x.) + 16 + 2( e+/-) + 3 chars, that
-       is 24 characters.
-
-       This function normalizes the input string in a passed buffer that
-       must be of at least 25 bytes (with terminating 0). Make it 32 for
-       safety... */
+    dec->mantissa = 0;
+    dec->exponent = dec->text_exponent = 0;
+    dec->nb_digits = dec->text_length = 0;
+    dec->negative = dec->truncated = dec->sticky = false;
 
-#define MAX_DECIMAL_NUMBER_STRING_LENGTH 32
-#define MAX_DECIMAL_MANTISSA             18
-
-    int c = ctxt->source.get( &ctxt->source );
+    int c = get_next_char( ctxt );
     if ( '-' == c ) {
-        *buffer++ = c;
-        c = ctxt->source.get( &ctxt->source ); // accept negative sign
+        dec->negative = true;
+        c = get_next_char( ctxt );     // accept negative sign
     }
-    int nb_mantissa_digits = 0;
-    int exponent;
     if ( '0' == c ) {                  // first 0 must be the whole integer part
-        integer_part = true;
-        *buffer++ = c;
-        *buffer++ = '.';
-        exponent = 0;
-        c = ctxt->source.get( &ctxt->source );
+        c = get_next_char( ctxt );
     } else if ( isdigit( c ) ) {       // Non zero begins integer part
-        integer_part = true;
-        exponent = -1;                 // will be incremented in loop
         do {
-            if ( nb_mantissa_digits <  MAX_DECIMAL_MANTISSA ) {
-                *buffer++ = c;         // keep significant digits
-                if ( 1 == ++nb_mantissa_digits )
-                    *buffer++ = '.';
-            }
-            ++exponent;                // always count 10 power
-            c = ctxt->source.get( &ctxt->source );
+            add_decimal_digit( dec, c, false );
+            c = get_next_char( ctxt );
         } while ( isdigit(c) );
-    }
-    if ( ! integer_part ) {            // not valid according to ECMA 404
+    } else {                           // not valid according to ECMA 404
         error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
                       "Syntax error while expecting a number: no integer part" );
         return false;
     }
     if ( '.' == c ) {                  // enter fractional part
-        c = ctxt->source.get( &ctxt->source );
+        c = get_next_char( ctxt );
         if ( ! isdigit( c ) ) {        // invalid fractional part
             error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
                       "Syntax error while expecting a number: no fractional part after '.'" );
             return false;
         }
         do {
-            if ( nb_mantissa_digits <  MAX_DECIMAL_MANTISSA ) {
-               *buffer++ = c;          // keep significant digits, ignore extra
-               ++nb_mantissa_digits;
-            }
-            c = ctxt->source.get( &ctxt->source );
+            add_decimal_digit( dec, c, true );
+            c = get_next_char( ctxt );
         } while ( isdigit(c) );
     }
 
     int literal_exponent = 0;
     if ( 'e' == c || 'E' == c ) {      // enter exponent
-        c = ctxt->source.get( &ctxt->source );
+        c = get_next_char( ctxt );
         int exponent_sign = 1;
         if ( '+' == c || '-' == c ) {
             if ( '-' == c ) exponent_sign = -1;
-            c = ctxt->source.get( &ctxt->source ); // skip exponent sign
+            c = get_next_char( ctxt ); // skip exponent sign
         }
         if ( ! isdigit( c ) ) {        // invalid exponent
             error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
@@ -744,67 +1035,128 @@ static bool normalize_ecma_404_num( json_parse_ctxt_t *ctxt, char *buffer )
             return false;
         }
         do {
-            literal_exponent *= 10;
-            literal_exponent += exponent_sign * (c - '0');
-            c = ctxt->source.get( &ctxt->source );
+            if ( literal_exponent < MAX_DECIMAL_EXPONENT ) {
+                literal_exponent *= 10;
+                literal_exponent += c - '0';
+            }
+            c = get_next_char( ctxt );
         } while ( isdigit(c) );
+        literal_exponent *= exponent_sign;
     }
-    ctxt->source.push_back( &ctxt->source, c ); // backtrack last read char
-    exponent += literal_exponent;
-    if ( exponent ) { // 2( e+/-) + 3 chars
-        buffer += snprintf( buffer, 6, "e%d", exponent );
-    }
-    *buffer = 0;
+    push_back_char( ctxt, c );         // backtrack last read char
+    dec->exponent += literal_exponent;
+    dec->text_exponent += literal_exponent;
     return true;
 }
 
-static number_t *make_json_number_from_double( double number )
+// return true if the decimal number is an integer that fits in long long
+static bool decimal_to_integer( decimal_number_t *dec, long long int *integer )
 {
-// the C compiler removes the non-relevant ifs (it keeps only the proper check)
-    if ( 8 == sizeof(long long int) ) {
-        if ( -9223372036854775807LL > number ||
-              9223372036854775807LL < number )
-            return new_number( JSON_REAL_NUMBER, 0, number );
-    } else if ( 4 == sizeof( long long int ) ) {
-        if ( -2147483647 > number || 2147483647 < number )
-            return new_number( JSON_REAL_NUMBER, 0, number );
-    } else { // assume 16 bit only
-        if ( -32768 > number || 32768 < number )
-            return new_number( JSON_REAL_NUMBER, 0, number );
+    if ( dec->truncated ) return false;
+
+    uint64_t mantissa = dec->mantissa;
+    int exponent = dec->exponent;
+    if ( 0 == mantissa ) {
+        *integer = 0;
+        return true;
+    }
+    while ( exponent < 0 && 0 == mantissa % 10 ) { // remove trailing 0s
+        mantissa /= 10;
+        ++exponent;
+    }
+    if ( exponent < 0 ) return false;  // not an integer
+    for ( ; exponent; --exponent ) {
+        if ( mantissa > UINT64_MAX / 10 ) return false;
+        mantissa *= 10;
+    }
+    if ( dec->negative ) {
+        if ( mantissa > (uint64_t)INT64_MAX + 1 ) return false;
+        *integer = ( mantissa == (uint64_t)INT64_MAX + 1 ) ?
+                                INT64_MIN : -(long long int)mantissa;
+    } else {
+        if ( mantissa > (uint64_t)INT64_MAX ) return false;
+        *integer = (long long int)mantissa;
     }
-    double ipart;
-    modf( number, &ipart );
-    return ( ipart == number ) ? new_number( JSON_INTEGER_NUMBER, number, 0 )
-                               : new_number( JSON_REAL_NUMBER, 0, number );
+    return true;
 }
 
-static number_t *make_number( json_parse_ctxt_t *ctxt )
+// return false in case of range error
+static bool decimal_to_double( decimal_number_t *dec, double *real )
 {
-    assert( ctxt );
+    static const double power_of_ten[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+#define MAX_EXACT_MANTISSA      ( (uint64_t)1 << 53 )
+#define MAX_EXACT_POWER_OF_TEN  22
+
+    if ( 0 == dec->mantissa ) {        // no significant digit
+        *real = ( dec->negative ) ? -0.0 : 0.0;
+        return true;
+    }
+    if ( ! dec->truncated && dec->mantissa <= MAX_EXACT_MANTISSA ) {
+        uint64_t mantissa = dec->mantissa;
+        int exponent = dec->exponent;
+        /* if the exponent is too large, try to move some of it into the
+           mantissa, as long as the mantissa stays exact (1e22 < 2^53 * 1e15) */
+        while ( exponent > MAX_EXACT_POWER_OF_TEN &&
+                mantissa <= MAX_EXACT_MANTISSA / 10 ) {
+            mantissa *= 10;
+            --exponent;
+        }
+        if ( exponent >= -MAX_EXACT_POWER_OF_TEN &&
+             exponent <= MAX_EXACT_POWER_OF_TEN ) {
+            double d = (double)mantissa;
+            if ( exponent < 0 )
+                d /= power_of_ten[ -exponent ];
+            else
+                d *= power_of_ten[ exponent ];
+            *real = ( dec->negative ) ? -d : d;
+            return true;
+        }
+    }
 
-    char buffer[MAX_DECIMAL_NUMBER_STRING_LENGTH];
-    if ( ! normalize_ecma_404_num( ctxt, buffer ) ) return NULL;
+    // slow path: let strtod round the complete list of significant digits
+    char *text = dec->text;
+    unsigned int length = dec->text_length;
+    int exponent = dec->text_exponent;
+    if ( dec->sticky ) {               // any extra non-zero digit is enough
+        text[ length++ ] = '1';
+        --exponent;
+    }
+    snprintf( text + length, 14, "e%d", exponent );
 
     char *moved;
     errno = 0;   // make sure errno is not set
-    double d = strtod( buffer, &moved );
-    if ( moved == buffer || ERANGE == errno ) {
-        error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
-                                 "number cannot be represented (range error)" );
-        return NULL;
-    }
-    /* strtod is more lenient and may accept digits beyond the ECMA definition.
-       The following line forces the next char to be the one defined by ECMA
-       404, which if it is within the number input accepted by strtod will
-       cause an error immediately after ( e.g. for 0001 strtod is happy to
-       consume the whole number whereas ECMA 404 stops after the first 0). */
+    double d = strtod( text, &moved );
+    if ( moved == text || ERANGE == errno ) return false;
+    *real = ( dec->negative ) ? -d : d;
+    return true;
+}
+
+// the number is stored in place, return false in case of error
+static bool make_number( json_parse_ctxt_t *ctxt, number_t *number )
+{
+    assert( ctxt );
 
-    number_t *number = make_json_number_from_double( d );
-    if ( NULL == number ) {
+    decimal_number_t dec;
+    if ( ! parse_ecma_404_num( ctxt, &dec ) ) return false;
+
+    long long int integer;
+    double real;
+    if ( decimal_to_integer( &dec, &integer ) ) {
+        set_number( number, JSON_INTEGER_NUMBER, integer, 0 );
+    } else if ( decimal_to_double( &dec, &real ) ) {
+        /* a whole number within the integer range was converted exactly above
+           (e.g. 1.234e3 is 1234): any other number is real, even if rounding
+           made it whole */
+        set_number( number, JSON_REAL_NUMBER, 0, real );
+    } else {
         error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
-                                 "Out of memory while  while expecting a number" );
+                                 "number cannot be represented (range error)" );
+        return false;
     }
-    return number;
+    return true;
 }
 
 static bool check_litteral( json_parse_ctxt_t *ctxt, const unsigned char *litteral )
@@ -812,7 +1164,7 @@ static bool check_litteral( json_parse_ctxt_t *ctxt, const unsigned char *litter
     int c;
     const unsigned char *ref = litteral + 1;
     do {
-        c = ctxt->source.get( &ctxt->source );
+        c = get_next_char( ctxt );
         if ( *ref != c ) {
             error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
             "Syntax error (character 0x%02x '%c') while expecting %s",
@@ -838,106 +1190,615 @@ static int make_boolean( json_parse_ctxt_t *ctxt, unsigned char c )
     return -1;
 }
 
-static json_value_t *make_value( json_parse_ctxt_t *ctxt )
+/* The value is allocated only once its data is available, since null, true,
+   false and small integers do not need any allocation (shared values). The
+   first character c of the value was already read. */
+static json_value_t *make_scalar( json_parse_ctxt_t *ctxt, int c )
 {
     assert( ctxt );
 
     json_value_type_t vtype;
     value_data_t vdata;
-
-    json_value_t *value = malloc( sizeof( json_value_t ) );
-    if ( NULL == value ) return NULL;
+    uint8_t vflags = ( ctxt->arena ) ? JSON_VALUE_IN_ARENA : 0;
+    json_value_t *value;
 
     int boolean;
-    int c = skip_blank( ctxt );
+    unsigned char *string;
     switch ( c ) {
-    case '{':
-        vtype = JSON_OBJECT;
-        if ( ++ctxt->open_stack > MAX_OPEN_DEPTH ) {
-            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                            "ran out of allocated stack depth in processing object\n");
-            goto error_exit;
-        }
-        vdata.object = make_object( ctxt );
-        if ( NULL == vdata.object ) goto error_exit;
-        --ctxt->open_stack;
-        break;
-    case '[':
-        vtype = JSON_ARRAY;
-        if ( ++ctxt->open_stack > MAX_OPEN_DEPTH ) {
-            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
-                            "ran out of allocated stack depth in processing array\n");
-            goto error_exit;
-        }
-        vdata.array = make_array( ctxt );
-        if ( NULL == vdata.array ) goto error_exit;
-        --ctxt->open_stack;
-        break;
     case '"':
         vtype = JSON_STRING;
-        vdata.string = make_string( ctxt );
-        if ( NULL == vdata.string ) goto error_exit;
+        string = make_string( ctxt, vdata.short_string, SHORT_STRING_SIZE );
+        if ( NULL == string ) return NULL;
+        if ( string == vdata.short_string ) {
+            vflags |= JSON_VALUE_SHORT_STRING;
+        } else {
+            vdata.string = string;
+            if ( ctxt->in_situ ) vflags |= JSON_VALUE_IN_SITU;
+        }
         break;
     default:
         if ( EOF == c ) {
             error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
                           "Syntax error (end of text) while expecting value");
-            goto error_exit;
+            return NULL;
         }
         if ( ! isdigit( c ) ) {
             wrong_char_error_report( ctxt, "while expecting value", c );
-            goto error_exit;
+            return NULL;
         } // else falls though number case (next line needed to silence gcc)
         // fall through
     case '-':
         vtype = JSON_NUMBER;
-        ctxt->source.push_back( &ctxt->source, c ); // backtrack 1 char
-        vdata.number = make_number( ctxt );
-        if ( NULL == vdata.number ) goto error_exit;
+        push_back_char( ctxt, c ); // backtrack 1 char
+        if ( ! make_number( ctxt, &vdata.number ) ) return NULL;
+        if ( JSON_INTEGER_NUMBER == vdata.number.ntype ) {
+            value = get_small_integer_value( vdata.number.ndata.integer );
+            if ( value ) return value;
+        }
         break;
     case 't': case 'f':
-        vtype = JSON_BOOLEAN;
         boolean = make_boolean( ctxt, c );
-        if ( -1 == boolean ) goto error_exit;
-        vdata.boolean = (bool)boolean;
-        break;
+        if ( -1 == boolean ) return NULL;
+        return get_boolean_value( (bool)boolean );
     case 'n':
-        vtype = JSON_NULL;
         if ( ! check_litteral( ctxt, (const unsigned char *)"null" ) )
-            goto error_exit;
-        vdata.string = NULL; // any pointer would work here
-        break;
+            return NULL;
+        return get_null_value( );
+    }
+
+    value = arena_malloc( ctxt->arena, sizeof( json_value_t ) );
+    if ( NULL == value ) {
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "Out of memory while creating a value" );
+        if ( JSON_STRING == vtype && ! ( vflags & JSON_VALUE_SHORT_STRING ) &&
+             ! ctxt->in_situ )
+            arena_free( ctxt->arena, vdata.string );
+        return NULL;
     }
     value->vtype = vtype;
+    value->vflags = vflags;
     value->vdata = vdata;
     return value;
+}
+
+/*  Arrays and objects are parsed without recursion: the containers being
+    parsed are kept in an explicit stack, which starts in the C stack and
+    grows in the heap for deeper documents, up to the context max_depth.
+    Each open object keeps the name of the member whose value is being
+    parsed, and each container its last member or element, for appending. */
+
+#define LOCAL_CONTAINERS    32      // containers before growing in heap
+
+typedef struct {
+    json_value_type_t   vtype;      // JSON_OBJECT or JSON_ARRAY
+    union {
+        object_t        *object;
+        array_t         *array;
+    } container;
+    union {
+        member_t        *member;
+        element_t       *element;
+    } last;
+    json_key_t          *key;       // name of the current member, or NULL
+} open_container_t;
+
+typedef struct {
+    open_container_t    *containers;
+    unsigned int        size;
+    unsigned int        depth;      // number of open containers
+    open_container_t    local[LOCAL_CONTAINERS];
+} container_stack_t;
+
+// c is '{' or '['. Return the new top of stack, or NULL in case of error.
+static open_container_t *open_container( json_parse_ctxt_t *ctxt,
+                                         container_stack_t *stack, int c )
+{
+    json_value_type_t vtype = ( '{' == c ) ? JSON_OBJECT : JSON_ARRAY;
+    if ( ctxt->open_stack >= ctxt->max_depth ) {
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "ran out of allocated stack depth in processing %s\n",
+                      ( JSON_OBJECT == vtype ) ? "object" : "array" );
+        return NULL;
+    }
+    if ( stack->depth == stack->size ) {
+        size_t size = 2 * (size_t)stack->size;
+        open_container_t *containers = ( stack->containers == stack->local ) ?
+                        malloc( size * sizeof( open_container_t ) ) :
+                        realloc( stack->containers, size * sizeof( open_container_t ) );
+        if ( NULL == containers ) {
+            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                          "Out of memory while opening a container" );
+            return NULL;
+        }
+        if ( stack->containers == stack->local )
+            memcpy( containers, stack->local, sizeof( stack->local ) );
+        stack->containers = containers;
+        stack->size = size;
+    }
+
+    open_container_t *top = &stack->containers[ stack->depth ];
+    top->vtype = vtype;
+    top->key = NULL;
+    if ( JSON_OBJECT == vtype ) {
+        top->container.object = new_object( ctxt->arena );
+        top->last.member = NULL;
+#ifdef _JSON_FAST_ACCESS_LARGER_CODE
+        if ( NULL == top->container.object ) {
+            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                          "Out of memory while creating an object" );
+            return NULL;
+        }
+#endif
+    } else {
+        top->container.array = new_array( ctxt->arena );
+        top->last.element = NULL;
+#ifdef _JSON_FAST_ACCESS_LARGER_CODE
+        if ( NULL == top->container.array ) {
+            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                          "Out of memory while creating an array" );
+            return NULL;
+        }
+#endif
+    }
+    ++stack->depth;
+    ++ctxt->open_stack;
+    return top;
+}
+
+static void free_container( json_parse_ctxt_t *ctxt, open_container_t *top )
+{
+    if ( top->key )
+        json_release_key( ctxt->arena, top->key->name );
+    if ( JSON_OBJECT == top->vtype )
+        json_free_object( top->container.object );
+    else
+        json_free_array( top->container.array );
+}
+
+// pop the top container and return its value, or NULL in case of error
+static json_value_t *close_container( json_parse_ctxt_t *ctxt,
+                                      container_stack_t *stack )
+{
+    open_container_t *top = &stack->containers[ --stack->depth ];
+    --ctxt->open_stack;
+
+    json_value_t *value = arena_malloc( ctxt->arena, sizeof( json_value_t ) );
+    if ( NULL == value ) {
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "Out of memory while creating a value" );
+        free_container( ctxt, top );
+        return NULL;
+    }
+    value->vtype = top->vtype;
+    value->vflags = ( ctxt->arena ) ? JSON_VALUE_IN_ARENA : 0;
+    if ( JSON_OBJECT == top->vtype )
+        value->vdata.object = top->container.object;
+    else
+        value->vdata.array = top->container.array;
+    return value;
+}
 
-error_exit:
-    free( value );
-    return NULL;
+// c must start a member name, followed by ':'
+static bool open_member( json_parse_ctxt_t *ctxt, open_container_t *top, int c )
+{
+    if ( '"' != c ) {
+        wrong_char_error_report( ctxt, "while expecting object member", c );
+        return false;
+    }
+    top->key = make_member_key( ctxt );
+    if ( NULL == top->key ) return false;
+
+    if ( ':' != skip_blank( ctxt ) ) {
+        error_report( ctxt, JSON_STATUS_PARSE_SYNTAX_ERROR,
+            "Syntax error (missing ':') while expecting \"name\" : value" );
+        return false;
+    }
+    return true;
 }
 
-extern json_value_t *json_parse_source( json_source_t *source,
-                                 bool comments, json_error_report_t *error )
+// the value is freed if it cannot be attached to the container
+static bool attach_value( json_parse_ctxt_t *ctxt, open_container_t *top,
+                          json_value_t *value )
 {
-    json_parse_ctxt_t ctxt;
-    ctxt.source.src = source->src;
-    ctxt.source.get = source->get;
-    ctxt.source.push_back = source->push_back;
-    ctxt.comments = comments;
-    ctxt.line = 1;
-    ctxt.estring[0] = 0;
-    ctxt.ecode = JSON_STATUS_SUCCESS;
-    ctxt.open_stack = 0;
+    if ( JSON_OBJECT == top->vtype ) {
+        member_t member;
+        set_interned_member( &member, top->key, value );
+        top->key = NULL;
+        object_t *extended = object_attach_member( top->container.object,
+                                                   &member, &top->last.member );
+        if ( NULL == extended ) {
+            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                          "Out of memory while extending an object" );
+            return false;
+        }
+        top->container.object = extended;
+        return true;
+    }
 
-    json_value_t *value = make_value( &ctxt );
+    element_t *element = new_element( value );
+    if ( NULL == element ) { // value was already freed
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "Out of memory while creating an element" );
+        return false;
+    }
+    array_t *array = array_append_element( top->container.array, element,
+                                           &top->last.element );
+    if ( NULL == array ) {   // array was freed in case of error
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "Out of memory while extending an array" );
+        top->vtype = JSON_NULL;
+        return false;
+    }
+    top->container.array = array;
+    return true;
+}
+
+static json_value_t *make_value( json_parse_ctxt_t *ctxt )
+{
+    assert( ctxt );
+
+    container_stack_t stack;
+    stack.containers = stack.local;
+    stack.size = LOCAL_CONTAINERS;
+    stack.depth = 0;
+
+    json_value_t *value;
+    int c = skip_blank( ctxt );
+    while ( true ) {                // c starts a value
+        if ( '{' == c || '[' == c ) {
+            open_container_t *top = open_container( ctxt, &stack, c );
+            if ( NULL == top ) { value = NULL; break; }
+
+            c = skip_blank( ctxt );
+            if ( JSON_OBJECT == top->vtype && '}' != c ) {
+                if ( ! open_member( ctxt, top, c ) ) { value = NULL; break; }
+                c = skip_blank( ctxt );
+                continue;           // first member value
+            }
+            if ( JSON_ARRAY == top->vtype && ']' != c )
+                continue;           // first element
+            value = close_container( ctxt, &stack ); // empty is ok
+        } else {
+            value = make_scalar( ctxt, c );
+        }
+
+        /* the value is complete: append it to its container, and close the
+           containers that end with it, until another value starts */
+        bool next_value = false;
+        while ( value && stack.depth ) {
+            open_container_t *top = &stack.containers[ stack.depth - 1 ];
+            if ( ! attach_value( ctxt, top, value ) ) {
+                value = NULL;
+                break;
+            }
+
+            c = skip_blank( ctxt );
+            int end = ( JSON_OBJECT == top->vtype ) ? '}' : ']';
+            if ( ',' == c ) {
+                c = skip_blank( ctxt );
+#if ACCEPT_LAST_COMMA
+                if ( end == c ) {
+                    value = close_container( ctxt, &stack );
+                    continue;
+                }
+#endif
+                if ( JSON_OBJECT == top->vtype ) {
+                    if ( ! open_member( ctxt, top, c ) ) {
+                        value = NULL;
+                        break;
+                    }
+                    c = skip_blank( ctxt );
+                }
+                next_value = true;
+                break;
+            }
+            if ( end == c ) {
+                value = close_container( ctxt, &stack );
+                continue;
+            }
+            wrong_char_error_report( ctxt, ( JSON_OBJECT == top->vtype ) ?
+                                           "while expecting object member" :
+                                           "while expecting ',' or ']'", c );
+            value = NULL;
+        }
+        if ( ! next_value ) break;
+    }
+
+    while ( stack.depth ) {         // in case of error
+        open_container_t *top = &stack.containers[ --stack.depth ];
+        --ctxt->open_stack;
+        if ( JSON_NULL != top->vtype )  // else the array was already freed
+            free_container( ctxt, top );
+    }
+    if ( stack.containers != stack.local )
+        free( stack.containers );
+    return value;
+}
+
+static element_t *make_element( json_parse_ctxt_t *ctxt )
+{
+    json_value_t *value = make_value( ctxt );
+    if ( NULL == value )
+        return NULL;
+    element_t *element = new_element( value );
+    if ( NULL == element ) { // value was already freed
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                                "Out of memory while creating an element" );
+    }
+    return element;
+}
+
+/*  -------------------------------------------------------------------
+    lexical interface, shared with the other parsers (see jsonlex.h)
+    -------------------------------------------------------------------  */
+
+extern void json_lex_init_buffer( json_parse_ctxt_t *ctxt,
+                                  const unsigned char *buffer, size_t len,
+                                  bool comments )
+{
+    ctxt->source.src = NULL;
+    ctxt->source.get = NULL;        // no callback: read directly from buffer
+    ctxt->source.push_back = NULL;
+    ctxt->blocks.src = NULL;
+    ctxt->blocks.refill = NULL;
+    ctxt->ptr = buffer;
+    ctxt->end = buffer + len;
+    ctxt->start = buffer;
+    ctxt->base = 0;
+    ctxt->block = ctxt->block_end = NULL;
+    ctxt->last = 0;
+    ctxt->at_end = false;
+    ctxt->lines = 0;
+    ctxt->line_start = 0;
+    ctxt->stream = NULL;
+    ctxt->in_situ = false;
+    ctxt->check_only = false;
+    ctxt->head = ctxt->current = NULL;
+    ctxt->arena = NULL;
+    ctxt->keys = NULL;
+    ctxt->own_keys = false;
+    ctxt->comments = comments;
+    ctxt->estring[0] = 0;
+    ctxt->ecode = JSON_STATUS_SUCCESS;
+    ctxt->eoffset = 0;
+    ctxt->eprefix = 0;
+    ctxt->open_stack = 0;
+    ctxt->max_depth = MAX_OPEN_DEPTH;
+}
+
+extern void json_lex_init_source( json_parse_ctxt_t *ctxt,
+                                  const json_source_t *source, bool comments )
+{
+    json_lex_init_buffer( ctxt, NULL, 0, comments );
+    ctxt->source = *source;
+}
+
+extern void json_lex_init_block_source( json_parse_ctxt_t *ctxt,
+                                        const json_block_source_t *source,
+                                        bool comments )
+{
+    json_lex_init_buffer( ctxt, NULL, 0, comments );
+    ctxt->blocks = *source;         // read as memory buffers
+}
+
+static int get_next_stream_char( json_source_t *source )
+{
+    return fgetc( (FILE *)(source->src) );
+}
+
+static void push_back_stream_char( json_source_t *source, int c )
+{
+    if ( EOF == c ) return;
+    ungetc( c, (FILE *)(source->src) );
+}
+
+/* Streams and file descriptors are read by blocks of STREAM_BLOCK_SIZE bytes
+   into a buffer allocated with the context. */
+#define STREAM_BLOCK_SIZE   ( 64 * 1024 )
+
+typedef struct {
+    FILE            *fd;            // NULL if reading from a file descriptor
+    int             fdesc;
+    unsigned char   block[STREAM_BLOCK_SIZE];
+} stream_block_t;
+
+static size_t refill_stream_block( json_block_source_t *source,
+                                   const unsigned char **block )
+{
+    stream_block_t *stream = source->src;
+    *block = stream->block;
+    if ( stream->fd )
+        return fread( stream->block, 1, STREAM_BLOCK_SIZE, stream->fd );
+
+    ssize_t len;                    // a read error is handled as end of data
+    do {
+        len = read( stream->fdesc, stream->block, STREAM_BLOCK_SIZE );
+    } while ( -1 == len && EINTR == errno );
+    return ( len > 0 ) ? (size_t)len : 0;
+}
+
+static bool init_stream_block( json_parse_ctxt_t *ctxt, FILE *fd, int fdesc,
+                               bool comments )
+{
+    stream_block_t *stream = malloc( sizeof( stream_block_t ) );
+    if ( NULL == stream ) return false;
+    stream->fd = fd;
+    stream->fdesc = fdesc;
+
+    json_block_source_t source;
+    source.src = stream;
+    source.refill = refill_stream_block;
+    json_lex_init_block_source( ctxt, &source, comments );
+    ctxt->stream = stream;
+    return true;
+}
+
+extern void json_lex_init_stream( json_parse_ctxt_t *ctxt, FILE *fd,
+                                  bool comments )
+{
+    if ( init_stream_block( ctxt, fd, -1, comments ) ) return;
+
+    json_source_t source;           // fall back to reading characters
+    source.src = fd;
+    source.get = get_next_stream_char;
+    source.push_back = push_back_stream_char;
+    json_lex_init_source( ctxt, &source, comments );
+}
+
+extern void json_lex_release_stream( json_parse_ctxt_t *ctxt )
+{
+    free( ctxt->stream );
+    ctxt->stream = NULL;
+}
+
+extern int json_lex_skip_blank( json_parse_ctxt_t *ctxt )
+{
+    return skip_blank( ctxt );
+}
+
+extern void json_lex_push_back( json_parse_ctxt_t *ctxt, int c )
+{
+    push_back_char( ctxt, c );
+}
+
+extern unsigned char *json_lex_string( json_parse_ctxt_t *ctxt,
+                                       unsigned char *buffer, size_t size )
+{
+    return make_string( ctxt, buffer, size );
+}
+
+extern bool json_lex_skip_string( json_parse_ctxt_t *ctxt )
+{
+    ctxt->check_only = true;
+    unsigned char *string = make_string( ctxt, NULL, 0 );
+    ctxt->check_only = false;
+    return NULL != string;
+}
+
+extern bool json_lex_number( json_parse_ctxt_t *ctxt, number_t *number )
+{
+    return make_number( ctxt, number );
+}
+
+extern bool json_lex_literal( json_parse_ctxt_t *ctxt,
+                              const unsigned char *literal )
+{
+    return check_litteral( ctxt, literal );
+}
+
+extern void json_lex_error( json_parse_ctxt_t *ctxt, json_status_t code,
+                            const char *fmt, ... )
+{
+    va_list ap;
+
+    va_start( ap, fmt );
+    error_report_va( ctxt, code, fmt, ap );
+    va_end( ap );
+}
+
+extern void json_lex_wrong_char_error( json_parse_ctxt_t *ctxt,
+                                       const char *specific, int c )
+{
+    wrong_char_error_report( ctxt, specific, c );
+}
+
+extern void json_lex_set_error_position( json_parse_ctxt_t *ctxt,
+                                         const unsigned char *start,
+                                         const unsigned char *position )
+{
+    size_t offset = ctxt->base + (size_t)( position - start );
+
+    /* replace the error position in the error string prefix */
+    char prefix[64];
+    size_t new_length = (size_t)error_position( ctxt, start, offset,
+                                                prefix, sizeof(prefix) );
+    size_t old_length = ctxt->eprefix;
+    size_t message_length = strlen( &ctxt->estring[old_length] );
+    if ( new_length + message_length >= MAX_ERROR_STRING_LENGTH )
+        message_length = MAX_ERROR_STRING_LENGTH - 1 - new_length;
+
+    memmove( &ctxt->estring[new_length], &ctxt->estring[old_length],
+             message_length );
+    ctxt->estring[new_length + message_length] = 0;
+    memcpy( ctxt->estring, prefix, new_length );
+    ctxt->eprefix = (unsigned int)new_length;
+}
+
+extern void json_lex_report( const json_parse_ctxt_t *ctxt,
+                             json_error_report_t *error )
+{
     if ( error ) {
-        error->status = ctxt.ecode;
-        if ( ctxt.estring[0] )
-            error->error_string = strdup( ctxt.estring );
+        error->status = ctxt->ecode;
+        error->offset = ctxt->eoffset;
+        if ( ctxt->estring[0] )
+            error->error_string = strdup( ctxt->estring );
         else
             error->error_string = NULL;
     }
+}
+
+/* the private key table is not needed anymore once parsing is done, since
+   keys are freed with the last member using them */
+static void release_private_keys( json_parse_ctxt_t *ctxt )
+{
+    if ( ctxt->own_keys ) {
+        json_free_key_table( ctxt->keys );
+        ctxt->keys = NULL;
+        ctxt->own_keys = false;
+    }
+}
+
+extern array_t *json_parse_elements( json_parse_ctxt_t *ctxt, array_t *array )
+{
+    element_t *last_element = NULL;
+    while ( true ) {
+        element_t *element = make_element( ctxt );
+        if ( NULL == element ) {
+            json_free_array( array );
+            array = NULL;
+            break;
+        }
+        array = array_append_element( array, element, &last_element );
+        if ( NULL == array ) {  // array was freed in case of error
+            error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                                  "Out of memory while extending an array" );
+            break;
+        }
+
+        int c = skip_blank( ctxt );
+        if ( EOF == c ) break;
+        if ( ',' != c ) {
+            wrong_char_error_report( ctxt, "while expecting ',' or ']'", c );
+            json_free_array( array );
+            array = NULL;
+            break;
+        }
+    }
+    release_private_keys( ctxt );
+    return array;
+}
+
+extern json_value_t *json_parse_source( json_source_t *source,
+                                 bool comments, json_error_report_t *error )
+{
+    json_parse_ctxt_t ctxt;
+    json_lex_init_source( &ctxt, source, comments );
+
+    json_value_t *value = make_value( &ctxt );
+    release_private_keys( &ctxt );
+    json_lex_report( &ctxt, error );
+    return value;
+}
+
+extern json_value_t *json_parse_block_source( json_block_source_t *source,
+                                 bool comments, json_error_report_t *error )
+{
+    json_parse_ctxt_t ctxt;
+    json_lex_init_block_source( &ctxt, source, comments );
+
+    json_value_t *value = make_value( &ctxt );
+    release_private_keys( &ctxt );
+    json_lex_report( &ctxt, error );
     return value;
 }
 
@@ -952,91 +1813,223 @@ static json_value_t *json_parse_data( json_parse_ctxt_t *ctxt )
             wrong_char_error_report( ctxt, "while expecting end of text", c );
         }
     }
+    release_private_keys( ctxt );
     return value;
 }
 
-static int get_next_stream_char( json_source_t *source )
+/* In arena mode, the root value is finally copied into the arena itself, so
+   that freeing the root can release the whole arena. Any error releases the
+   arena, whatever was allocated in it. */
+static json_value_t *json_parse_data_in_arena( json_parse_ctxt_t *ctxt,
+                                               size_t size_hint,
+                                               bool huge_pages )
 {
-    return fgetc( (FILE *)(source->src) );
+    ctxt->arena = json_new_arena( size_hint, huge_pages );
+    if ( NULL == ctxt->arena ) {
+        error_report( ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "Out of memory while creating an arena" );
+        return NULL;
+    }
+    json_value_t *value = json_parse_data( ctxt );
+    if ( NULL == value ) {
+        json_release_arena( ctxt->arena );
+        return NULL;
+    }
+    ctxt->arena->root = *value;     // possibly a copy of a shared value
+    ctxt->arena->root.vflags = ( value->vflags & ~JSON_VALUE_STATIC ) |
+                               JSON_VALUE_IN_ARENA | JSON_VALUE_ARENA_ROOT;
+    return &ctxt->arena->root;
 }
 
-static void push_back_stream_char( json_source_t *source, int c )
+static json_value_t *parse_stream( FILE *fd, bool comments, bool in_arena,
+                                   bool huge_pages, json_key_table_t *keys,
+                                   json_error_report_t *error )
 {
-    if ( EOF == c ) return;
-    ungetc( c, (FILE *)(source->src) );
+    json_parse_ctxt_t ctxt;
+    json_lex_init_stream( &ctxt, fd, comments );
+    ctxt.keys = keys;
+
+    json_value_t *value = ( in_arena ) ?
+                          json_parse_data_in_arena( &ctxt, 0, huge_pages ) :
+                          json_parse_data( &ctxt );
+    if ( NULL == value && JSON_STATUS_SUCCESS == ctxt.ecode ) {
+        error_report( &ctxt, JSON_STATUS_INVALID_PARAMETERS, "Empty source stream\n" );
+    }
+    json_lex_release_stream( &ctxt );
+    json_lex_report( &ctxt, error );
+    return value;
 }
 
 extern json_value_t *json_parse_stream( FILE *fd, bool comments, json_error_report_t *error )
+{
+    return parse_stream( fd, comments, false, false, NULL, error );
+}
+
+extern json_value_t *json_parse_fd( int fd, bool comments,
+                                    json_error_report_t *error )
 {
     json_parse_ctxt_t ctxt;
-    ctxt.source.src = fd;
-    ctxt.source.get = get_next_stream_char;
-    ctxt.source.push_back = push_back_stream_char;
-    ctxt.comments = comments;
-    ctxt.line = 1;
-    ctxt.estring[0] = 0;
-    ctxt.ecode = JSON_STATUS_SUCCESS;
-    ctxt.open_stack = 0;
-
-    json_value_t *value = json_parse_data( &ctxt );
-    if ( NULL == value && JSON_STATUS_SUCCESS == ctxt.ecode ) {
-        error_report( &ctxt, JSON_STATUS_INVALID_PARAMETERS, "Empty source stream\n" );
-    }
-    if ( error ) {
-        error->status = ctxt.ecode;
-        if ( ctxt.estring[0] )
-            error->error_string = strdup( ctxt.estring );
-        else
-            error->error_string = NULL;
+    json_value_t *value = NULL;
+    if ( ! init_stream_block( &ctxt, NULL, fd, comments ) ) {
+        json_lex_init_buffer( &ctxt, NULL, 0, comments );
+        error_report( &ctxt, JSON_STATUS_OUT_OF_MEMORY,
+                      "Out of memory while allocating a stream block" );
+    } else {
+        value = json_parse_data( &ctxt );
+        if ( NULL == value && JSON_STATUS_SUCCESS == ctxt.ecode ) {
+            error_report( &ctxt, JSON_STATUS_INVALID_PARAMETERS,
+                          "Empty source stream\n" );
+        }
+        json_lex_release_stream( &ctxt );
     }
+    json_lex_report( &ctxt, error );
     return value;
 }
 
-static int get_next_buffer_char( json_source_t *source )
+extern json_value_t *json_parse_stream_arena( FILE *fd, bool comments,
+                                              bool huge_pages,
+                                              json_error_report_t *error )
 {
-    unsigned char *ptr = source->src;
-    if ( 0 == *ptr ) return EOF;  // stays on end of file
-
-    int c = *ptr;
-    source->src = ++ptr;
-    return c;
+    return parse_stream( fd, comments, true, huge_pages, NULL, error );
 }
 
-static void push_back_buffer_char( json_source_t *source, int c )
+extern json_value_t *json_parse_stream_shared_keys( FILE *fd, bool comments,
+                                                    json_key_table_t *keys,
+                                                    json_error_report_t *error )
 {
-    if ( EOF == c ) return;
-    unsigned char *ptr = source->src;
-    source->src = --ptr;
+    return parse_stream( fd, comments, false, false, keys, error );
 }
 
-extern json_value_t *json_parse_buffer( const unsigned char *buffer,
-                                        bool comments,
-                                        json_error_report_t *error )
+static json_value_t *parse_buffer( const unsigned char *buffer, size_t len,
+                                   bool comments, bool in_arena,
+                                   bool huge_pages, json_key_table_t *keys,
+                                   json_error_report_t *error )
 {
     json_parse_ctxt_t ctxt;
-    ctxt.source.src = (void *)buffer;
-    ctxt.source.get = get_next_buffer_char;
-    ctxt.source.push_back = push_back_buffer_char;
-    ctxt.comments = comments;
-    ctxt.line = 1;
-    ctxt.estring[0] = 0;
-    ctxt.ecode = JSON_STATUS_SUCCESS;
-    ctxt.open_stack = 0;
+    json_lex_init_buffer( &ctxt, buffer, len, comments );
+    ctxt.keys = keys;
 
     json_value_t *value;
-    if ( buffer ) {
-        value = json_parse_data( &ctxt );
+    if ( buffer ) {    // the tree is usually about the size of the text
+        value = ( in_arena ) ?
+                json_parse_data_in_arena( &ctxt, len, huge_pages ) :
+                json_parse_data( &ctxt );
     } else {
         value = NULL;
         error_report( &ctxt, JSON_STATUS_INVALID_PARAMETERS, "Empty source buffer\n" );
     }
+    json_lex_report( &ctxt, error );
+    return value;
+}
 
-    if ( error ) {
-        error->status = ctxt.ecode;
-        if ( ctxt.estring[0] )
-            error->error_string = strdup( ctxt.estring );
-        else
-            error->error_string = NULL;
+extern json_value_t *json_parse_buffer_n( const unsigned char *buffer,
+                                          size_t len, bool comments,
+                                          json_error_report_t *error )
+{
+    return parse_buffer( buffer, len, comments, false, false, NULL, error );
+}
+
+extern json_value_t *json_parse_buffer_arena( const unsigned char *buffer,
+                                              size_t len, bool comments,
+                                              bool huge_pages,
+                                              json_error_report_t *error )
+{
+    return parse_buffer( buffer, len, comments, true, huge_pages, NULL, error );
+}
+
+extern json_value_t *json_parse_buffer_shared_keys( const unsigned char *buffer,
+                                                    size_t len, bool comments,
+                                                    json_key_table_t *keys,
+                                                    json_error_report_t *error )
+{
+    return parse_buffer( buffer, len, comments, false, false, keys, error );
+}
+
+/* In situ, strings are decoded and terminated in the buffer itself, and the
+   tree refers to them instead of copies. Strings are never longer than their
+   text, and the terminating 0 replaces at most the closing '"', which is
+   never read again. */
+static json_value_t *parse_buffer_ctxt( json_parse_ctxt_t *ctxt,
+                                        json_error_report_t *error )
+{
+    json_value_t *value;
+    if ( ctxt->ptr ) {
+        value = json_parse_data( ctxt );
+    } else {
+        value = NULL;
+        error_report( ctxt, JSON_STATUS_INVALID_PARAMETERS, "Empty source buffer\n" );
+    }
+    json_lex_report( ctxt, error );
+    return value;
+}
+
+extern json_value_t *json_parse_buffer_in_situ( unsigned char *buffer,
+                                                size_t len, bool comments,
+                                                json_error_report_t *error )
+{
+    json_parse_ctxt_t ctxt;
+    json_lex_init_buffer( &ctxt, buffer, len, comments );
+    ctxt.in_situ = true;
+    return parse_buffer_ctxt( &ctxt, error );
+}
+
+extern json_value_t *json_parse_buffer_max_depth( const unsigned char *buffer,
+                                                  size_t len, bool comments,
+                                                  unsigned int max_depth,
+                                                  json_error_report_t *error )
+{
+    json_parse_ctxt_t ctxt;
+    json_lex_init_buffer( &ctxt, buffer, len, comments );
+    ctxt.max_depth = max_depth;
+    return parse_buffer_ctxt( &ctxt, error );
+}
+
+extern json_value_t *json_parse_buffer( const unsigned char *buffer,
+                                        bool comments,
+                                        json_error_report_t *error )
+{
+    size_t len = ( buffer ) ? strlen( (const char *)buffer ) : 0;
+    return json_parse_buffer_n( buffer, len, comments, error );
+}
+
+/* A regular file is mapped in memory and parsed as a buffer: the text is
+   neither copied nor terminated. Since all strings are copied into the tree,
+   the file is unmapped as soon as it is parsed. Other files (pipes, devices)
+   or files that cannot be mapped are read by blocks. */
+#ifndef MAP_POPULATE
+#define MAP_POPULATE    0           // pages are then faulted in while parsing
+#endif
+
+extern json_value_t *json_parse_file( const char *path, bool comments,
+                                      json_error_report_t *error )
+{
+    int fd = ( path ) ? open( path, O_RDONLY ) : -1;
+    if ( -1 == fd ) {
+        json_parse_ctxt_t ctxt;
+        json_lex_init_buffer( &ctxt, NULL, 0, comments );
+        error_report( &ctxt, JSON_STATUS_INVALID_PARAMETERS,
+                      "Cannot open file %s: %s\n", ( path ) ? path : "(null)",
+                      strerror( errno ) );
+        json_lex_report( &ctxt, error );
+        return NULL;
+    }
+
+    json_value_t *value;
+    struct stat st;
+    void *text = MAP_FAILED;
+    if ( 0 == fstat( fd, &st ) && S_ISREG( st.st_mode ) && st.st_size > 0 &&
+         (uintmax_t)st.st_size <= SIZE_MAX )
+        text = mmap( NULL, (size_t)st.st_size, PROT_READ,
+                     MAP_PRIVATE | MAP_POPULATE, fd, 0 );
+    if ( MAP_FAILED != text ) {
+#ifdef MADV_SEQUENTIAL
+        (void)madvise( text, (size_t)st.st_size, MADV_SEQUENTIAL );
+#endif
+        value = json_parse_buffer_n( text, (size_t)st.st_size, comments, error );
+        munmap( text, (size_t)st.st_size );
+    } else {
+        value = json_parse_fd( fd, comments, error );
     }
+    close( fd );
     return value;
 }
@@ -7,13 +7,18 @@
 #include <stdio.h>
 #include "jsonvalue.h"
 
+/* In case of error, offset is the position in the text of the character
+   where the error was detected, or the text length if the error was detected
+   at the end of the text. The error string gives its line and column. */
 typedef struct {
     char          *error_string;
     json_status_t status;
+    size_t        offset;
 } json_error_report_t;
 
-#define MAX_OPEN_DEPTH  256  // limit number of open arrays & objects to
-                             // prevent potential stack overflow in parser.
+#define MAX_OPEN_DEPTH  256  // default limit of open arrays & objects, to
+                             // prevent potential stack overflow when trees
+                             // are freed, duplicated or serialized.
 
 /* parse the given json text given as const char buffer (zero terminated UTF8
    characters), accepting C/C++ comments only if the argument comments is true.
@@ -32,10 +37,98 @@ extern json_value_t *json_parse_buffer( const unsigned char *buffer,
                                         bool comments,
                                         json_error_report_t *error );
 
-/* Same as above, but directly from a file, pipe or terminal input */
+/* Same as above, but the text is given as a buffer of len bytes, which does
+   not need to be zero terminated. The text is read directly from the buffer,
+   and parsing stops at buffer + len. */
+extern json_value_t *json_parse_buffer_n( const unsigned char *buffer,
+                                          size_t len, bool comments,
+                                          json_error_report_t *error );
+
+/* Same as json_parse_buffer_n, but in situ: strings are decoded in place in
+   the buffer, which is modified, and string values refer to the buffer
+   instead of copies, so that parsing does not allocate any string. The
+   buffer must remain valid and unchanged as long as the tree is in use, and
+   is modified even if the text is not valid. Member names are still interned
+   as usual. */
+extern json_value_t *json_parse_buffer_in_situ( unsigned char *buffer,
+                                                size_t len, bool comments,
+                                                json_error_report_t *error );
+
+/* Same as json_parse_buffer_n, but with at most max_depth nested arrays and
+   objects instead of MAX_OPEN_DEPTH. The parser itself does not recurse, so
+   that the limit is only bounded by memory, however freeing, duplicating or
+   serializing a tree is recursive and requires stack in proportion to its
+   depth. */
+extern json_value_t *json_parse_buffer_max_depth( const unsigned char *buffer,
+                                                  size_t len, bool comments,
+                                                  unsigned int max_depth,
+                                                  json_error_report_t *error );
+
+/* Same as json_parse_buffer, but directly from a file, pipe or terminal input */
 extern json_value_t *json_parse_stream( FILE *fd, bool comments,
                                         json_error_report_t *error );
 
+/* Same as json_parse_stream, but directly from a file descriptor, which is
+   read by large blocks with read(2). The file descriptor is not closed. */
+extern json_value_t *json_parse_fd( int fd, bool comments,
+                                    json_error_report_t *error );
+
+/* Same as json_parse_buffer_n, but directly from the file at path, which is
+   mapped in memory and parsed in place, without reading the whole file into
+   a separate buffer first. Files that cannot be mapped, like pipes, are read
+   as with json_parse_fd. */
+extern json_value_t *json_parse_file( const char *path, bool comments,
+                                      json_error_report_t *error );
+
+/* Same as json_parse_buffer_n and json_parse_stream, but the whole tree is
+   allocated in a single memory arena, instead of one heap allocation per
+   value, string, number, member or table. The tree is freed as usual with
+   json_free, which releases the whole arena at once.
+
+   If huge_pages is true, the arena memory is mapped with huge pages when the
+   system supports them (on linux, transparent huge pages), which reduces TLB
+   misses for large documents.
+
+   The tree can still be edited: inserted values remain in the heap and are
+   freed with the tree. Values taken out of the tree (removed or replaced) can
+   be passed to json_free_value, but if they were parsed they remain in the
+   arena and are valid only until the tree root is freed. Iterators should be
+   freed before the tree, otherwise the tree must be walked to free them. */
+extern json_value_t *json_parse_buffer_arena( const unsigned char *buffer,
+                                              size_t len, bool comments,
+                                              bool huge_pages,
+                                              json_error_report_t *error );
+
+extern json_value_t *json_parse_stream_arena( FILE *fd, bool comments,
+                                              bool huge_pages,
+                                              json_error_report_t *error );
+
+/* Member names are interned while parsing: all members with the same name in
+   a document share a single copy of that name, with its hash value, which
+   saves memory and speeds up member lookups in documents made of many
+   objects with the same layout.
+
+   By default, the names are interned in a table private to the document. A
+   key table can also be shared by several documents, as long as they are
+   parsed in the same thread, so that all documents share the same names.
+   Names are never removed from a shared table, which must be freed after use
+   by calling json_free_key_table (documents can be freed before or after). */
+typedef struct _json_key_table json_key_table_t;
+
+extern json_key_table_t *json_new_key_table( void );
+extern void json_free_key_table( json_key_table_t *keys );
+
+/* Same as json_parse_buffer_n and json_parse_stream, but member names are
+   interned in the given shared key table (json_new_key_table) */
+extern json_value_t *json_parse_buffer_shared_keys( const unsigned char *buffer,
+                                                    size_t len, bool comments,
+                                                    json_key_table_t *keys,
+                                                    json_error_report_t *error );
+
+extern json_value_t *json_parse_stream_shared_keys( FILE *fd, bool comments,
+                                                    json_key_table_t *keys,
+                                                    json_error_report_t *error );
+
 /* the underlying common interface for any type of data parser */
 typedef struct _json_source json_source_t;
 
@@ -52,6 +145,32 @@ extern json_value_t *json_parse_source( json_source_t *source,
                                         bool comments,
                                         json_error_report_t *error );
 
+/* A block source hands the parser a whole block of bytes at a time, instead
+   of one character at a time as a json_source_t does.
+
+   The refill function sets *block to the next block of bytes and returns its
+   length, or 0 at the end of data (it is not called again after that). The
+   block must remain valid and unchanged until the next call, as the parser
+   reads it directly, as a memory buffer, and keeps its own lookahead.
+
+   Streams given to json_parse_stream and json_parse_fd are read by blocks,
+   so that parsing them is almost as fast as parsing a memory buffer. Since
+   they are read ahead, bytes following the json text or the first error may
+   have been consumed from the stream. */
+typedef struct _json_block_source json_block_source_t;
+
+typedef size_t (*refill_block_fct)( json_block_source_t *source,
+                                    const unsigned char **block );
+
+struct _json_block_source {
+    void               *src;
+    refill_block_fct   refill;     // return 0 if no more data
+};
+
+extern json_value_t *json_parse_block_source( json_block_source_t *source,
+                                              bool comments,
+                                              json_error_report_t *error );
+
 /* free the json tree passed as root */
 extern void json_free( json_value_t *root );
 
@@ -0,0 +1,874 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "jsonpush.h"
+#include "jsondata.h"
+#include "jsonkey.h"
+#include "jsonlex.h"
+#include "jsonscan.h"
+
+/*  -----------------------------------------------------------------
+    push parsing
+    -----------------------------------------------------------------  */
+
+/* The parser is a state machine driven by each chunk of text. Blanks,
+   comments and structural characters are processed by the machine itself,
+   whereas strings, numbers and literals are located first and then read by
+   the shared lexical functions (jsonlex.h), directly from the chunk if they
+   are entirely in it, or from a copy in the token buffer if they are split
+   across chunks. */
+
+typedef enum {
+    PUSH_VALUE,             // expecting a value
+    PUSH_FIRST_ELEMENT,     // after '[': expecting a value or ']'
+    PUSH_FIRST_MEMBER,      // after '{': expecting a member or '}'
+    PUSH_MEMBER,            // after ',' in object: expecting a member
+    PUSH_COLON,             // after a member name: expecting ':'
+    PUSH_NEXT,              // after a value in a container: ',' or close
+    PUSH_END,               // after the root value: expecting end of text
+    PUSH_STRING,            // in a string split across chunks
+    PUSH_SCALAR,            // in a number or literal split across chunks
+    PUSH_COMMENT_START,     // after '/'
+    PUSH_LINE_COMMENT,      // in a C++ comment
+    PUSH_BLOCK_COMMENT,     // in a C comment
+    PUSH_BLOCK_STAR,        // after '*' in a C comment
+    PUSH_ERROR
+} push_state_t;
+
+/* tree building: container under construction at each open level */
+typedef struct {
+    json_value_t            *container; // NULL if freed after an error
+    json_key_t              *key;       // pending member name in objects
+    member_t                *last_member;
+    element_t               *last_element;
+} build_level_t;
+
+struct _json_parser {
+    json_parse_ctxt_t               lex;
+    const json_event_callbacks_t    *callbacks;
+    void                            *user;
+
+    push_state_t            state;
+    push_state_t            saved;      // state to resume after a comment
+    bool                    escaped;    // last byte was '\\' (string, comment)
+    bool                    is_key;     // string is a member name
+    unsigned int            depth;
+    unsigned char           stack[MAX_OPEN_DEPTH];  // '{' or '['
+
+    unsigned char           *token;     // token split across chunks
+    size_t                  token_length;
+    size_t                  token_size;
+
+    unsigned int            nb_levels;  // tree building only
+    build_level_t           levels[MAX_OPEN_DEPTH];
+    json_value_t            *root;
+};
+
+#define TOKEN_BUFFER_SIZE   64
+
+/* call an optional callback, and record the stop request as an error */
+#define EMIT( _parser, _event )                                             \
+    ( NULL == (_parser)->callbacks->_event ||                               \
+      (_parser)->callbacks->_event( (_parser)->user ) || stopped( _parser ) )
+
+#define EMIT_DATA( _parser, _event, ... )                                   \
+    ( NULL == (_parser)->callbacks->_event ||                               \
+      (_parser)->callbacks->_event( (_parser)->user, __VA_ARGS__ ) ||       \
+      stopped( _parser ) )
+
+/* the error reported by a tree building callback is kept */
+static bool stopped( json_parser_t *parser )
+{
+    if ( JSON_STATUS_SUCCESS == parser->lex.ecode )
+        json_lex_error( &parser->lex, JSON_STATUS_STOPPED,
+                        "parsing stopped by callback" );
+    return false;
+}
+
+/*  ------------------------ tree building ---------------------------- */
+
+static bool build_error( json_parser_t *parser, const char *what )
+{
+    json_lex_error( &parser->lex, JSON_STATUS_OUT_OF_MEMORY,
+                    "Out of memory while %s", what );
+    return false;
+}
+
+static json_value_t *build_value( json_parser_t *parser,
+                                  json_value_type_t vtype )
+{
+    json_value_t *value = malloc( sizeof( json_value_t ) );
+    if ( NULL == value ) {
+        build_error( parser, "creating a value" );
+        return NULL;
+    }
+    value->vtype = vtype;
+    value->vflags = 0;
+    return value;
+}
+
+/* attach a complete value to the container being built, or make it root.
+   The value is freed if it cannot be attached */
+static bool build_attach( json_parser_t *parser, json_value_t *value )
+{
+    if ( 0 == parser->nb_levels ) {
+        parser->root = value;
+        return true;
+    }
+
+    build_level_t *level = &parser->levels[parser->nb_levels-1];
+    if ( JSON_OBJECT == level->container->vtype ) {
+        member_t member;
+        set_interned_member( &member, level->key, value );
+        level->key = NULL;
+        object_t *extended = object_attach_member(
+                                    level->container->vdata.object,
+                                    &member, &level->last_member );
+        if ( NULL == extended )
+            return build_error( parser, "extending an object" );
+        level->container->vdata.object = extended;
+        return true;
+    }
+
+    element_t *element = new_element( value );
+    if ( NULL == element )  // value was already freed
+        return build_error( parser, "creating an element" );
+
+    array_t *extended = array_append_element( level->container->vdata.array,
+                                              element, &level->last_element );
+    if ( NULL == extended ) {   // array was freed
+        free( level->container );
+        level->container = NULL;
+        return build_error( parser, "extending an array" );
+    }
+    level->container->vdata.array = extended;
+    return true;
+}
+
+static bool build_container( json_parser_t *parser, json_value_type_t vtype )
+{
+    json_value_t *value = build_value( parser, vtype );
+    if ( NULL == value ) return false;
+
+    if ( JSON_OBJECT == vtype ) {
+        value->vdata.object = new_object( NULL );
+        if ( NULL == value->vdata.object ) {
+            free( value );
+            return build_error( parser, "creating an object" );
+        }
+    } else {
+        value->vdata.array = new_array( NULL );
+        if ( NULL == value->vdata.array ) {
+            free( value );
+            return build_error( parser, "creating an array" );
+        }
+    }
+
+    build_level_t *level = &parser->levels[parser->nb_levels++];
+    level->container = value;
+    level->key = NULL;
+    level->last_member = NULL;
+    level->last_element = NULL;
+    return true;
+}
+
+static bool build_start_object( void *user )
+{
+    return build_container( (json_parser_t *)user, JSON_OBJECT );
+}
+
+static bool build_start_array( void *user )
+{
+    return build_container( (json_parser_t *)user, JSON_ARRAY );
+}
+
+static bool build_end( void *user )
+{
+    json_parser_t *parser = user;
+    json_value_t *container = parser->levels[--parser->nb_levels].container;
+    return build_attach( parser, container );
+}
+
+static bool build_key( void *user, const unsigned char *name, size_t length )
+{
+    json_parser_t *parser = user;
+    if ( NULL == parser->lex.keys ) {
+        parser->lex.keys = json_new_private_key_table( );
+        if ( NULL == parser->lex.keys )
+            return build_error( parser, "creating a key table" );
+        parser->lex.own_keys = true;
+    }
+
+    json_key_t *key = json_intern_key( parser->lex.keys, NULL, name, length );
+    if ( NULL == key )
+        return build_error( parser, "interning a member name" );
+    parser->levels[parser->nb_levels-1].key = key;
+    return true;
+}
+
+static bool build_string( void *user, const unsigned char *string,
+                          size_t length )
+{
+    (void)length;
+    json_parser_t *parser = user;
+    json_value_t *value = build_value( parser, JSON_STRING );
+    if ( NULL == value ) return false;
+    if ( ! set_string_copy( value, string ) ) {
+        free( value );
+        return build_error( parser, "copying a string" );
+    }
+    return build_attach( parser, value );
+}
+
+static bool build_integer( void *user, long long int integer )
+{
+    json_parser_t *parser = user;
+    json_value_t *value = get_small_integer_value( integer );
+    if ( NULL == value ) {
+        value = build_value( parser, JSON_NUMBER );
+        if ( NULL == value ) return false;
+        set_number( &value->vdata.number, JSON_INTEGER_NUMBER, integer, 0 );
+    }
+    return build_attach( parser, value );
+}
+
+static bool build_real( void *user, double real )
+{
+    json_parser_t *parser = user;
+    json_value_t *value = build_value( parser, JSON_NUMBER );
+    if ( NULL == value ) return false;
+    set_number( &value->vdata.number, JSON_REAL_NUMBER, 0, real );
+    return build_attach( parser, value );
+}
+
+static bool build_boolean( void *user, bool boolean )
+{
+    return build_attach( (json_parser_t *)user, get_boolean_value( boolean ) );
+}
+
+static bool build_null( void *user )
+{
+    return build_attach( (json_parser_t *)user, get_null_value( ) );
+}
+
+static const json_event_callbacks_t build_callbacks = {
+    build_start_object, build_key, build_end,
+    build_start_array, build_end,
+    build_string, build_integer, build_real, build_boolean, build_null
+};
+
+/* the private key table is not needed anymore once the root is complete,
+   since keys are freed with the last member using them */
+static void release_private_keys( json_parser_t *parser )
+{
+    if ( parser->lex.own_keys ) {
+        json_free_key_table( parser->lex.keys );
+        parser->lex.keys = NULL;
+        parser->lex.own_keys = false;
+    }
+}
+
+/* free all containers under construction, after an error */
+static void discard_tree( json_parser_t *parser )
+{
+    while ( parser->nb_levels ) {
+        build_level_t *level = &parser->levels[--parser->nb_levels];
+        if ( level->key )
+            json_release_key( NULL, level->key->name );
+        if ( level->container )
+            json_free( level->container );
+    }
+    release_private_keys( parser );
+}
+
+/*  --------------------------- tokens -------------------------------- */
+
+static bool append_token( json_parser_t *parser, const unsigned char *data,
+                          size_t len )
+{
+    if ( 0 == len ) return true;
+    if ( parser->token_length + len > parser->token_size ) {
+        size_t size = ( parser->token_size ) ? parser->token_size
+                                             : TOKEN_BUFFER_SIZE;
+        while ( size < parser->token_length + len ) size *= 2;
+
+        unsigned char *token = realloc( parser->token, size );
+        if ( NULL == token ) {
+            json_lex_error( &parser->lex, JSON_STATUS_OUT_OF_MEMORY,
+                            "Out of memory while buffering a token" );
+            return false;
+        }
+        parser->token = token;
+        parser->token_size = size;
+    }
+    memcpy( parser->token + parser->token_length, data, len );
+    parser->token_length += len;
+    return true;
+}
+
+/* read the token in memory from start to end with the shared lexer */
+static void lex_from( json_parser_t *parser, const unsigned char *start,
+                      const unsigned char *end )
+{
+    parser->lex.ptr = start;
+    parser->lex.end = end;
+    parser->lex.at_end = false;     // end of token, not of text
+}
+
+/* A token split across chunks is not accounted for in the lexer position
+   until it is read: the text from its start is then in the token buffer, so
+   that the lexer gives the exact error position. Once read, its part in the
+   previous chunks is accounted for, and positions are in the chunk again. */
+static void lex_from_token( json_parser_t *parser )
+{
+    parser->lex.start = parser->token;
+    lex_from( parser, parser->token, parser->token + parser->token_length );
+}
+
+static void end_token( json_parser_t *parser, size_t previous,
+                       const unsigned char *chunk )
+{
+    json_lex_end_block( &parser->lex, parser->token, parser->token + previous );
+    parser->lex.start = chunk;
+}
+
+/* report an unexpected character (or EOF) in the current state */
+static void unexpected( json_parser_t *parser, int c )
+{
+    json_parse_ctxt_t *lex = &parser->lex;
+    switch ( parser->state ) {
+    case PUSH_VALUE: case PUSH_FIRST_ELEMENT:
+        if ( EOF == c )
+            json_lex_error( lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+                            "Syntax error (end of text) while expecting value" );
+        else
+            json_lex_wrong_char_error( lex, "while expecting value", c );
+        break;
+    case PUSH_FIRST_MEMBER: case PUSH_MEMBER:
+        json_lex_wrong_char_error( lex, "while expecting object member", c );
+        break;
+    case PUSH_COLON:
+        json_lex_error( lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+            "Syntax error (missing ':') while expecting \"name\" : value" );
+        break;
+    case PUSH_NEXT:
+        json_lex_wrong_char_error( lex, ( '{' == parser->stack[parser->depth-1] ) ?
+                                   "while expecting object member" :
+                                   "while expecting ',' or ']'", c );
+        break;
+    default:
+        json_lex_wrong_char_error( lex, "while expecting end of text", c );
+        break;
+    }
+}
+
+static void value_done( json_parser_t *parser )
+{
+    if ( parser->depth ) {
+        parser->state = PUSH_NEXT;
+    } else {
+        parser->state = PUSH_END;
+        release_private_keys( parser );
+    }
+}
+
+/* strings are read in the context name buffer if they fit, or allocated
+   just for the time of the callback */
+static bool emit_string( json_parser_t *parser )
+{
+    unsigned char *string = json_lex_string( &parser->lex,
+                                             parser->lex.name_buffer,
+                                             NAME_BUFFER_SIZE );
+    if ( NULL == string ) return false;
+
+    size_t length = strlen( (const char *)string );
+    bool done = ( parser->is_key ) ? EMIT_DATA( parser, key, string, length )
+                                   : EMIT_DATA( parser, string, string, length );
+    if ( string != parser->lex.name_buffer ) free( string );
+    if ( ! done ) return false;
+
+    if ( parser->is_key )
+        parser->state = PUSH_COLON;
+    else
+        value_done( parser );
+    return true;
+}
+
+/* read a number or a literal up to end, and check that it stopped at
+   scalar_end, which is the end of the token (the first delimiter). */
+static bool emit_scalar( json_parser_t *parser,
+                         const unsigned char *scalar_end )
+{
+    json_parse_ctxt_t *lex = &parser->lex;
+    int c = *lex->ptr;
+    bool done;
+
+    if ( 't' == c || 'f' == c ) {
+        ++lex->ptr;
+        if ( ! json_lex_literal( lex, (const unsigned char *)
+                                 ( ( 't' == c ) ? "true" : "false" ) ) )
+            return false;
+        done = EMIT_DATA( parser, boolean, 't' == c );
+    } else if ( 'n' == c ) {
+        ++lex->ptr;
+        if ( ! json_lex_literal( lex, (const unsigned char *)"null" ) )
+            return false;
+        done = EMIT( parser, null );
+    } else {
+        number_t number;
+        if ( ! json_lex_number( lex, &number ) ) return false;
+        if ( JSON_INTEGER_NUMBER == number.ntype )
+            done = EMIT_DATA( parser, integer, number.ndata.integer );
+        else
+            done = EMIT_DATA( parser, real, number.ndata.real );
+    }
+    if ( ! done ) return false;
+
+    value_done( parser );
+    if ( lex->ptr < scalar_end ) {  // the next character cannot follow
+        c = *lex->ptr++;
+        unexpected( parser, c );
+        return false;
+    }
+    return true;
+}
+
+static inline bool is_scalar_char( int c )
+{
+    switch ( c ) {
+    case 0x09: case 0x0a: case 0x0d: case 0x20:
+    case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+    case '/':
+        return false;
+    default:
+        return true;
+    }
+}
+
+/* return the position of the closing '"' of a string in [p, end), or NULL
+   if the string continues after end. On entry, *escaped tells if the first
+   byte is escaped, and on return if the first byte after end is escaped */
+static const unsigned char *find_string_end( const unsigned char *p,
+                                             const unsigned char *end,
+                                             bool *escaped )
+{
+    bool non_ascii;
+    if ( *escaped && p < end ) {
+        ++p;
+        *escaped = false;
+    }
+    while ( p < end ) {
+        p = json_scan_string_span( p, end, &non_ascii );
+        if ( p == end ) break;
+        if ( '"' == *p ) return p;
+        if ( '\\' == *p && ++p == end ) {
+            *escaped = true;
+            break;
+        }
+        ++p;                    // escaped or control character
+    }
+    return NULL;
+}
+
+/* start a string after its opening '"' at p. Return the position after the
+   string, or end if it continues in the next chunk, or NULL on error */
+static const unsigned char *start_string( json_parser_t *parser,
+                                          const unsigned char *p,
+                                          const unsigned char *end,
+                                          bool is_key )
+{
+    parser->is_key = is_key;
+    parser->escaped = false;
+    const unsigned char *close = find_string_end( p, end, &parser->escaped );
+    if ( close ) {
+        lex_from( parser, p, end );
+        if ( ! emit_string( parser ) ) return NULL;
+        return parser->lex.ptr;
+    }
+    parser->token_length = 0;
+    if ( ! append_token( parser, p, (size_t)( end - p ) ) ) return NULL;
+    parser->state = PUSH_STRING;
+    return end;
+}
+
+/* continued at the start of the next chunk, at p */
+static const unsigned char *continue_string( json_parser_t *parser,
+                                             const unsigned char *p,
+                                             const unsigned char *end )
+{
+    const unsigned char *close = find_string_end( p, end, &parser->escaped );
+    if ( NULL == close ) {
+        if ( ! append_token( parser, p, (size_t)( end - p ) ) ) return NULL;
+        return end;
+    }
+    size_t previous = parser->token_length;
+    if ( ! append_token( parser, p, (size_t)( close + 1 - p ) ) ) return NULL;
+    lex_from_token( parser );
+    if ( ! emit_string( parser ) ) return NULL;
+    end_token( parser, previous, p );
+    return close + 1;
+}
+
+/* start a number or a literal at p. Return the position after it, or end
+   if it continues in the next chunk, or NULL on error */
+static const unsigned char *start_scalar( json_parser_t *parser,
+                                          const unsigned char *p,
+                                          const unsigned char *end )
+{
+    const unsigned char *q = p + 1;
+    while ( q < end && is_scalar_char( *q ) ) ++q;
+    if ( q < end ) {
+        lex_from( parser, p, end );
+        if ( ! emit_scalar( parser, q ) ) return NULL;
+        return q;
+    }
+    parser->token_length = 0;
+    if ( ! append_token( parser, p, (size_t)( end - p ) ) ) return NULL;
+    parser->state = PUSH_SCALAR;
+    return end;
+}
+
+/* the delimiter following the token is copied as well, so that the lexer
+   reads the same characters as from a single buffer, but it is not consumed */
+static const unsigned char *continue_scalar( json_parser_t *parser,
+                                             const unsigned char *p,
+                                             const unsigned char *end )
+{
+    const unsigned char *q = p;
+    size_t previous = parser->token_length;
+    while ( q < end && is_scalar_char( *q ) ) ++q;
+    if ( ! append_token( parser, p, (size_t)( q - p ) ) ) return NULL;
+    if ( q == end ) return end;
+
+    size_t length = parser->token_length;
+    if ( ! append_token( parser, q, 1 ) ) return NULL;
+    lex_from_token( parser );
+    if ( ! emit_scalar( parser, parser->token + length ) ) return NULL;
+    end_token( parser, previous, p );
+    return q;
+}
+
+/*  ------------------------ state machine ---------------------------- */
+
+static bool open_container( json_parser_t *parser, int c )
+{
+    if ( parser->depth == MAX_OPEN_DEPTH ) {
+        json_lex_error( &parser->lex, JSON_STATUS_OUT_OF_MEMORY,
+                        "ran out of allocated stack depth in processing %s\n",
+                        ( '{' == c ) ? "object" : "array" );
+        return false;
+    }
+    parser->stack[parser->depth++] = (unsigned char)c;
+    if ( '{' == c ) {
+        if ( ! EMIT( parser, start_object ) ) return false;
+        parser->state = PUSH_FIRST_MEMBER;
+    } else {
+        if ( ! EMIT( parser, start_array ) ) return false;
+        parser->state = PUSH_FIRST_ELEMENT;
+    }
+    return true;
+}
+
+static bool close_container( json_parser_t *parser )
+{
+    if ( '{' == parser->stack[--parser->depth] ) {
+        if ( ! EMIT( parser, end_object ) ) return false;
+    } else {
+        if ( ! EMIT( parser, end_array ) ) return false;
+    }
+    value_done( parser );
+    return true;
+}
+
+/* process the structural character at p, which is not blank. Return the
+   position of the next character to process, or NULL on error */
+static const unsigned char *structural( json_parser_t *parser,
+                                        const unsigned char *p,
+                                        const unsigned char *end )
+{
+    int c = *p;
+    switch ( parser->state ) {
+    case PUSH_FIRST_ELEMENT:
+        if ( ']' == c ) break;          // empty array is ok
+        // fall through
+    case PUSH_VALUE:
+        switch ( c ) {
+        case '{': case '[':
+            if ( ! open_container( parser, c ) ) return NULL;
+            return p + 1;
+        case '"':
+            return start_string( parser, p + 1, end, false );
+        case 't': case 'f': case 'n': case '-':
+            return start_scalar( parser, p, end );
+        default:
+            if ( isdigit( c ) )
+                return start_scalar( parser, p, end );
+            unexpected( parser, c );
+            return NULL;
+        }
+    case PUSH_FIRST_MEMBER:
+        if ( '}' == c ) break;          // empty object is ok
+        // fall through
+    case PUSH_MEMBER:
+        if ( '"' == c )
+            return start_string( parser, p + 1, end, true );
+        unexpected( parser, c );
+        return NULL;
+    case PUSH_COLON:
+        if ( ':' == c ) {
+            parser->state = PUSH_VALUE;
+            return p + 1;
+        }
+        unexpected( parser, c );
+        return NULL;
+    case PUSH_NEXT:
+        if ( ',' == c ) {
+            parser->state = ( '{' == parser->stack[parser->depth-1] ) ?
+                            PUSH_MEMBER : PUSH_VALUE;
+            return p + 1;
+        }
+        if ( ( '{' == parser->stack[parser->depth-1] ) ? '}' == c : ']' == c )
+            break;
+        unexpected( parser, c );
+        return NULL;
+    default:
+        unexpected( parser, c );
+        return NULL;
+    }
+    if ( ! close_container( parser ) ) return NULL;
+    return p + 1;
+}
+
+/* Comments are skipped as with the tree parser: a '\\' escapes the end of
+   line in C++ comments, and the following '*' in C comments */
+static const unsigned char *skip_comment( json_parser_t *parser,
+                                          const unsigned char *p,
+                                          const unsigned char *end )
+{
+    switch ( parser->state ) {
+    case PUSH_COMMENT_START:
+        parser->escaped = false;
+        if ( '/' == *p ) {
+            parser->state = PUSH_LINE_COMMENT;
+        } else if ( '*' == *p ) {
+            parser->state = PUSH_BLOCK_COMMENT;
+        } else {        // the previous '/' is an error
+            parser->state = parser->saved;
+            parser->lex.ptr = p;
+            unexpected( parser, '/' );
+            return NULL;
+        }
+        return p + 1;
+
+    case PUSH_LINE_COMMENT:
+        while ( p < end ) {
+            const unsigned char *lf = memchr( p, 0x0a, (size_t)( end - p ) );
+            if ( NULL == lf ) {
+                parser->escaped = ( '\\' == end[-1] );
+                return end;
+            }
+            bool escaped = ( lf > p ) ? ( '\\' == lf[-1] ) : parser->escaped;
+            parser->escaped = false;
+            p = lf + 1;
+            if ( ! escaped ) {
+                parser->state = parser->saved;
+                break;
+            }
+        }
+        return p;
+
+    case PUSH_BLOCK_COMMENT:
+        for ( ; p < end; ++p ) {
+            int c = *p;
+            if ( '*' == c ) {
+                parser->state = PUSH_BLOCK_STAR;
+                return p + 1;
+            }
+            parser->escaped = ( '\\' == c );
+        }
+        return p;
+
+    default:    // PUSH_BLOCK_STAR
+        if ( '/' == *p && ! parser->escaped ) {
+            parser->state = parser->saved;
+            return p + 1;
+        }
+        if ( '*' == *p ) return p + 1;
+        parser->state = PUSH_BLOCK_COMMENT;     // read *p again
+        return p;
+    }
+}
+
+/* Lines are not counted while consuming a chunk, but only once the chunk is
+   consumed. The lexer cursor is set after each character processed here, so
+   that errors are positioned at that character, or in the token read. */
+static void consume( json_parser_t *parser, const unsigned char *p,
+                     const unsigned char *end )
+{
+    const unsigned char *chunk = p;
+    if ( PUSH_STRING != parser->state && PUSH_SCALAR != parser->state )
+        parser->lex.start = chunk;  // else set once the pending token is read
+
+    while ( p < end ) {
+        parser->lex.ptr = p + 1;
+        switch ( parser->state ) {
+        case PUSH_ERROR:
+            return;
+        case PUSH_STRING:
+            p = continue_string( parser, p, end );
+            break;
+        case PUSH_SCALAR:
+            p = continue_scalar( parser, p, end );
+            break;
+        case PUSH_COMMENT_START: case PUSH_LINE_COMMENT:
+        case PUSH_BLOCK_COMMENT: case PUSH_BLOCK_STAR:
+            p = skip_comment( parser, p, end );
+            break;
+        default:
+            switch ( *p ) {
+            case 0x09: /* tab */ case 0x0a: /* LF */
+            case 0x0d: /* CR */  case 0x20: /* space */
+                p = json_skip_blank_span( p + 1, end );
+                continue;
+            case '/':
+                if ( parser->lex.comments ) {
+                    parser->saved = parser->state;
+                    parser->state = PUSH_COMMENT_START;
+                    ++p;
+                    continue;
+                }
+                break;
+            default:
+                break;
+            }
+            p = structural( parser, p, end );
+            break;
+        }
+        if ( NULL == p ) {
+            parser->state = PUSH_ERROR;
+            return;
+        }
+    }
+    if ( PUSH_STRING == parser->state || PUSH_SCALAR == parser->state ) {
+        if ( parser->lex.start == chunk )   // the token starts in the chunk
+            json_lex_end_block( &parser->lex, chunk,
+                                end - parser->token_length );
+    } else {
+        json_lex_end_block( &parser->lex, chunk, end );
+    }
+    parser->lex.start = NULL;   // until the next chunk, or the token is read
+}
+
+/* at the end of text, complete the pending token or comment */
+static void finish( json_parser_t *parser )
+{
+    parser->lex.ptr = NULL;         // errors are at the end of text
+    parser->lex.at_end = true;      // unless in the pending token
+    switch ( parser->state ) {
+    case PUSH_ERROR:
+        return;
+    case PUSH_STRING:       // not terminated: the lexer reports the error
+        lex_from_token( parser );
+        if ( ! emit_string( parser ) ) {
+            parser->state = PUSH_ERROR;
+            return;
+        }
+        end_token( parser, parser->token_length, NULL );
+        break;
+    case PUSH_SCALAR:
+        lex_from_token( parser );
+        if ( ! emit_scalar( parser, parser->lex.end ) ) {
+            parser->state = PUSH_ERROR;
+            return;
+        }
+        end_token( parser, parser->token_length, NULL );
+        break;
+    case PUSH_COMMENT_START:
+        parser->state = parser->saved;
+        unexpected( parser, '/' );
+        parser->state = PUSH_ERROR;
+        return;
+    case PUSH_LINE_COMMENT: case PUSH_BLOCK_COMMENT: case PUSH_BLOCK_STAR:
+        parser->state = parser->saved;
+        break;
+    default:
+        break;
+    }
+    if ( PUSH_END != parser->state ) {
+        parser->lex.ptr = NULL;     // after the pending token
+        parser->lex.at_end = true;
+        unexpected( parser, EOF );
+        parser->state = PUSH_ERROR;
+    }
+}
+
+extern json_parser_t *json_new_parser( bool comments,
+                                       const json_event_callbacks_t *callbacks,
+                                       void *user )
+{
+    json_parser_t *parser = malloc( sizeof( json_parser_t ) );
+    if ( NULL == parser ) return NULL;
+
+    json_lex_init_buffer( &parser->lex, NULL, 0, comments );
+    if ( NULL == callbacks ) {
+        parser->callbacks = &build_callbacks;
+        parser->user = parser;
+    } else {
+        parser->callbacks = callbacks;
+        parser->user = user;
+    }
+    parser->state = PUSH_VALUE;
+    parser->saved = PUSH_VALUE;
+    parser->escaped = false;
+    parser->is_key = false;
+    parser->depth = 0;
+    parser->token = NULL;
+    parser->token_length = parser->token_size = 0;
+    parser->nb_levels = 0;
+    parser->root = NULL;
+    return parser;
+}
+
+extern json_parser_status_t json_parser_feed( json_parser_t *parser,
+                                              const unsigned char *chunk,
+                                              size_t len )
+{
+    if ( PUSH_ERROR == parser->state ) return JSON_PARSER_ERROR;
+
+    if ( 0 == len )
+        finish( parser );
+    else
+        consume( parser, chunk, chunk + len );
+
+    if ( PUSH_ERROR == parser->state ) {
+        discard_tree( parser );
+        return JSON_PARSER_ERROR;
+    }
+    return ( PUSH_END == parser->state ) ? JSON_PARSER_DONE
+                                         : JSON_PARSER_NEED_MORE;
+}
+
+extern json_value_t *json_parser_get_value( json_parser_t *parser )
+{
+    if ( PUSH_ERROR == parser->state ) return NULL;
+
+    json_value_t *value = parser->root;
+    parser->root = NULL;
+    return value;
+}
+
+extern void json_parser_get_error_report( const json_parser_t *parser,
+                                          json_error_report_t *error )
+{
+    json_lex_report( &parser->lex, error );
+}
+
+extern void json_free_parser( json_parser_t *parser )
+{
+    if ( NULL == parser ) return;
+    discard_tree( parser );
+    if ( parser->root ) json_free( parser->root );
+    free( parser->token );
+    free( parser );
+}
@@ -0,0 +1,68 @@
+
+#ifndef __JSONPUSH_H__
+#define __JSONPUSH_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "jsonvalue.h"
+#include "jsonparse.h"
+#include "jsonevent.h"
+
+/* Resumable (push) parsing, for input received in chunks.
+
+   Instead of reading the text from a source until the end, the parser is
+   given the text by the application, one chunk at a time as it arrives (for
+   example from a non-blocking socket), and it returns after each chunk. The
+   parsing state (open containers, partial string, number or literal and
+   comments) is kept in the parser between chunks, so that chunks can be cut
+   anywhere in the text: only the token split across chunks is copied, never
+   the whole text.
+
+   The parser either builds a tree, or calls event callbacks as the text is
+   read (see jsonevent.h). Text is read exactly as with json_parse_buffer_n,
+   which reports the same errors. */
+
+typedef struct _json_parser json_parser_t;
+
+typedef enum {
+    JSON_PARSER_NEED_MORE,  // more text is needed to complete the value
+    JSON_PARSER_DONE,       // the value is complete (only blanks may follow)
+    JSON_PARSER_ERROR       // the text is invalid, or parsing was stopped
+} json_parser_status_t;
+
+/* create a parser, accepting C/C++ comments only if the argument comments
+   is true. If callbacks is NULL, a tree is built, which can be retrieved
+   with json_parser_get_value, otherwise the callbacks are called with the
+   user argument. Return NULL if memory cannot be allocated. */
+extern json_parser_t *json_new_parser( bool comments,
+                                       const json_event_callbacks_t *callbacks,
+                                       void *user );
+
+/* parse the next len bytes of text in chunk. The chunk is not needed anymore
+   once the function returns. The end of the text is given by a last chunk
+   of 0 byte, which is needed to complete a root number or to check the end
+   of an unterminated comment.
+
+   JSON_PARSER_DONE is returned as soon as the root value is complete and
+   the remaining text in the chunk is blank, but more blanks or comments can
+   still be given. In case of error, the error report is available from
+   json_parser_get_error_report, and the parser does not accept any more
+   text (JSON_PARSER_ERROR is always returned). */
+extern json_parser_status_t json_parser_feed( json_parser_t *parser,
+                                              const unsigned char *chunk,
+                                              size_t len );
+
+/* return the root value once the parser returned JSON_PARSER_DONE, or NULL.
+   The value is given to the caller, who must free it by calling json_free
+   after use. It is returned only once. */
+extern json_value_t *json_parser_get_value( json_parser_t *parser );
+
+/* fill the error report after the parser returned JSON_PARSER_ERROR. As with
+   the parser, the error string is allocated on the heap and must be freed */
+extern void json_parser_get_error_report( const json_parser_t *parser,
+                                          json_error_report_t *error );
+
+/* free the parser, and the tree being built if it was not retrieved */
+extern void json_free_parser( json_parser_t *parser );
+
+#endif /* __JSONPUSH_H__ */
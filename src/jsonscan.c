@@ -0,0 +1,236 @@
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "jsonscan.h"
+
+/*  -----------------------------------------------------------------
+    vectorized memory span scanning
+    -----------------------------------------------------------------  */
+
+static inline int is_blank( unsigned char c )
+{
+    return ' ' == c || 0x0a == c || 0x09 == c || 0x0d == c;
+}
+
+#if defined(__AVX2__)
+#define SCAN_BLOCK_SIZE  32
+typedef __m256i          scan_block_t;
+#define load_block( _p )            _mm256_loadu_si256( (const __m256i *)(_p) )
+#define set_block( _c )             _mm256_set1_epi8( (char)(_c) )
+#define equal_mask( _b, _v )        (uint32_t)_mm256_movemask_epi8( \
+                                        _mm256_cmpeq_epi8( (_b), (_v) ) )
+#define less_mask( _b, _v )         (uint32_t)_mm256_movemask_epi8( \
+                                        _mm256_cmpgt_epi8( (_v), (_b) ) )
+#define high_bit_mask( _b )         (uint32_t)_mm256_movemask_epi8( _b )
+#elif defined(__SSE2__)
+#define SCAN_BLOCK_SIZE  16
+typedef __m128i          scan_block_t;
+#define load_block( _p )            _mm_loadu_si128( (const __m128i *)(_p) )
+#define set_block( _c )             _mm_set1_epi8( (char)(_c) )
+#define equal_mask( _b, _v )        (uint32_t)_mm_movemask_epi8( \
+                                        _mm_cmpeq_epi8( (_b), (_v) ) )
+#define less_mask( _b, _v )         (uint32_t)_mm_movemask_epi8( \
+                                        _mm_cmpgt_epi8( (_v), (_b) ) )
+#define high_bit_mask( _b )         (uint32_t)_mm_movemask_epi8( _b )
+#endif
+
+extern const unsigned char *json_skip_blank_span( const unsigned char *ptr,
+                                                  const unsigned char *end )
+{
+#ifdef SCAN_BLOCK_SIZE
+    const scan_block_t space = set_block( ' ' ), lf = set_block( 0x0a );
+    const scan_block_t tab = set_block( 0x09 ), cr = set_block( 0x0d );
+
+    while ( end - ptr >= SCAN_BLOCK_SIZE ) {
+        scan_block_t block = load_block( ptr );
+        uint32_t blank_mask = equal_mask( block, space ) |
+                              equal_mask( block, lf ) |
+                              equal_mask( block, tab ) | equal_mask( block, cr );
+#if SCAN_BLOCK_SIZE < 32
+        uint32_t other_mask = ~blank_mask & ( ( 1U << SCAN_BLOCK_SIZE ) - 1 );
+#else
+        uint32_t other_mask = ~blank_mask;
+#endif
+        if ( other_mask )           // stop at the first non blank character
+            return ptr + __builtin_ctz( other_mask );
+        ptr += SCAN_BLOCK_SIZE;
+    }
+#endif
+    while ( ptr < end && is_blank( *ptr ) ) ++ptr;
+    return ptr;
+}
+
+extern const unsigned char *json_scan_string_span( const unsigned char *ptr,
+                                                   const unsigned char *end,
+                                                   bool *non_ascii )
+{
+    uint32_t high_mask = 0;
+#ifdef SCAN_BLOCK_SIZE
+    const scan_block_t quote = set_block( '"' ), backslash = set_block( '\\' );
+    const scan_block_t space = set_block( 0x20 );
+
+    while ( end - ptr >= SCAN_BLOCK_SIZE ) {
+        scan_block_t block = load_block( ptr );
+        /* signed comparison: bytes >= 0x80 are negative, hence less than
+           0x20 as well, they are removed from the control character mask */
+        uint32_t block_high_mask = high_bit_mask( block );
+        uint32_t mask = equal_mask( block, quote ) |
+                        equal_mask( block, backslash ) |
+                        ( less_mask( block, space ) & ~block_high_mask );
+        if ( mask ) {
+            unsigned int index = (unsigned int)__builtin_ctz( mask );
+            high_mask |= block_high_mask & ( ( 1U << index ) - 1 );
+            if ( high_mask ) *non_ascii = true;
+            return ptr + index;
+        }
+        high_mask |= block_high_mask;
+        ptr += SCAN_BLOCK_SIZE;
+    }
+#endif
+    for ( ; ptr < end; ++ptr ) {
+        unsigned char c = *ptr;
+        if ( '"' == c || '\\' == c || c < 0x20 ) break;
+        high_mask |= c & 0x80;
+    }
+    if ( high_mask ) *non_ascii = true;
+    return ptr;
+}
+
+/*  -----------------------------------------------------------------
+    structural index
+    -----------------------------------------------------------------  */
+
+#define STRUCTURAL_BLOCK_SIZE   64
+
+typedef struct {
+    uint64_t    quote;              // '"'
+    uint64_t    backslash;          // '\\'
+    uint64_t    structural;         // '{', '}', '[', ']', ':' or ','
+    uint64_t    blank;              // space, tab, CR or LF
+} block_masks_t;
+
+#ifdef SCAN_BLOCK_SIZE
+static inline void get_block_masks( const unsigned char *ptr,
+                                    block_masks_t *masks )
+{
+    const scan_block_t quote = set_block( '"' ), backslash = set_block( '\\' );
+    const scan_block_t lbrace = set_block( '{' ), rbrace = set_block( '}' );
+    const scan_block_t lbracket = set_block( '[' ), rbracket = set_block( ']' );
+    const scan_block_t colon = set_block( ':' ), comma = set_block( ',' );
+    const scan_block_t space = set_block( ' ' ), lf = set_block( 0x0a );
+    const scan_block_t tab = set_block( 0x09 ), cr = set_block( 0x0d );
+
+    masks->quote = masks->backslash = masks->structural = masks->blank = 0;
+    for ( unsigned int i = 0; i < STRUCTURAL_BLOCK_SIZE; i += SCAN_BLOCK_SIZE ) {
+        scan_block_t block = load_block( ptr + i );
+        masks->quote |= (uint64_t)equal_mask( block, quote ) << i;
+        masks->backslash |= (uint64_t)equal_mask( block, backslash ) << i;
+        masks->structural |= (uint64_t)( equal_mask( block, lbrace ) |
+                                         equal_mask( block, rbrace ) |
+                                         equal_mask( block, lbracket ) |
+                                         equal_mask( block, rbracket ) |
+                                         equal_mask( block, colon ) |
+                                         equal_mask( block, comma ) ) << i;
+        masks->blank |= (uint64_t)( equal_mask( block, space ) |
+                                    equal_mask( block, lf ) |
+                                    equal_mask( block, tab ) |
+                                    equal_mask( block, cr ) ) << i;
+    }
+}
+#else
+static inline void get_block_masks( const unsigned char *ptr,
+                                    block_masks_t *masks )
+{
+    masks->quote = masks->backslash = masks->structural = masks->blank = 0;
+    for ( unsigned int i = 0; i < STRUCTURAL_BLOCK_SIZE; ++i ) {
+        uint64_t bit = (uint64_t)1 << i;
+        switch ( ptr[i] ) {
+        case '"':  masks->quote |= bit; break;
+        case '\\': masks->backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+                   masks->structural |= bit; break;
+        case ' ': case 0x0a: case 0x09: case 0x0d:
+                   masks->blank |= bit; break;
+        default:   break;
+        }
+    }
+}
+#endif
+
+/* Return the mask of escaped characters, i.e. characters following an odd
+   sequence of backslashes. *prev_escaped carries over the first character of
+   the next block. */
+static inline uint64_t get_escaped_mask( uint64_t backslash,
+                                         uint64_t *prev_escaped )
+{
+    const uint64_t even_bits = 0x5555555555555555ULL;
+
+    backslash &= ~*prev_escaped;    // an escaped backslash escapes nothing
+    uint64_t follows_escape = ( backslash << 1 ) | *prev_escaped;
+    uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+
+    /* adding the sequence starts to the backslashes carries through each
+       sequence: the carry out of a sequence lands just after it */
+    uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    *prev_escaped = ( sequences_starting_on_even_bits < odd_sequence_starts );
+
+    uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return ( even_bits ^ invert_mask ) & follows_escape;
+}
+
+// each bit becomes the xor of all previous bits (included)
+static inline uint64_t prefix_xor( uint64_t mask )
+{
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+extern size_t json_find_structurals( const unsigned char *buffer, size_t len,
+                                     uint32_t *indexes, bool *unterminated )
+{
+    uint64_t prev_escaped = 0, prev_in_string = 0, prev_scalar = 0;
+    size_t count = 0;
+
+    for ( size_t offset = 0; offset < len; offset += STRUCTURAL_BLOCK_SIZE ) {
+        block_masks_t masks;
+        if ( len - offset >= STRUCTURAL_BLOCK_SIZE ) {
+            get_block_masks( buffer + offset, &masks );
+        } else {                    // pad the last block with blanks
+            unsigned char last[STRUCTURAL_BLOCK_SIZE];
+            memset( last, ' ', STRUCTURAL_BLOCK_SIZE );
+            memcpy( last, buffer + offset, len - offset );
+            get_block_masks( last, &masks );
+        }
+
+        uint64_t escaped = get_escaped_mask( masks.backslash, &prev_escaped );
+        uint64_t quote = masks.quote & ~escaped;
+
+        /* in_string includes the opening quote, but not the closing one */
+        uint64_t in_string = prefix_xor( quote ) ^ prev_in_string;
+        prev_in_string = (uint64_t)( (int64_t)in_string >> 63 );
+
+        uint64_t scalar = ~( masks.structural | masks.blank | quote | in_string );
+        uint64_t scalar_start = scalar & ~( ( scalar << 1 ) | prev_scalar );
+        prev_scalar = scalar >> 63;
+
+        uint64_t structurals = ( masks.structural & ~in_string ) |
+                               ( quote & in_string ) | scalar_start;
+        while ( structurals ) {
+            indexes[count++] = (uint32_t)( offset +
+                                           (size_t)__builtin_ctzll( structurals ) );
+            structurals &= structurals - 1;
+        }
+    }
+    *unterminated = ( 0 != prev_in_string );
+    return count;
+}
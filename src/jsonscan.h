@@ -0,0 +1,43 @@
+
+#ifndef __JSONSCAN_H__
+#define __JSONSCAN_H__
+
+/* Internal json library memory span scanning.
+
+   Those functions are used by the parser when the json text is available
+   in memory. They process multiple bytes at a time, using SSE2 or AVX2
+   instructions if the compiler targets them (-msse2, -mavx2, -march=...),
+   or a simple byte loop otherwise. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Skip json blank characters (space, tab, CR and LF) from ptr up to end.
+   Return a pointer to the first non blank character, or end if none */
+extern const unsigned char *json_skip_blank_span( const unsigned char *ptr,
+                                                  const unsigned char *end );
+
+/* Scan a string from ptr up to end, stopping at the first character that
+   requires attention: '"', '\\' or a control character (< 0x20). Return a
+   pointer to that character, or end if none. If any non ASCII byte (>= 0x80)
+   was skipped, *non_ascii is set to true (it is left unchanged otherwise) */
+extern const unsigned char *json_scan_string_span( const unsigned char *ptr,
+                                                   const unsigned char *end,
+                                                   bool *non_ascii );
+
+/* Find the structural characters in the len bytes of buffer: '{', '}', '[',
+   ']', ':' and ',' outside strings, the opening '"' of strings and the first
+   character of any other token (numbers, literals or invalid characters).
+   Their offsets are stored in indexes, which must have room for len + 1
+   entries, and their number is returned. Escaped characters are recognized
+   in strings, but not validated. If the last string is not terminated,
+   *unterminated is set to true.
+
+   The buffer is processed by blocks of 64 bytes, where each kind of
+   character is represented as a 64-bit mask, so that strings are found by
+   computing a prefix xor of the quote mask, without any branch. */
+extern size_t json_find_structurals( const unsigned char *buffer, size_t len,
+                                     uint32_t *indexes, bool *unterminated );
+
+#endif /* __JSONSCAN_H__ */
@@ -0,0 +1,568 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "jsontape.h"
+#include "jsondata.h"
+#include "jsonlex.h"
+#include "jsonscan.h"
+
+/*  -----------------------------------------------------------------
+    tape layout
+    -----------------------------------------------------------------  */
+
+/* Each word has its type in the 8 most significant bits and a payload in the
+   56 other bits:
+   - '{' and '[' (open): the distance in words from the open word to the word
+     following the matching close word (bits 0-31), and the number of members
+     or elements, saturated at TAPE_MAX_COUNT (bits 32-55),
+   - '}' and ']' (close): the distance in words back to the open word,
+   - '"' (string): the distance in bytes from the word to the string entry,
+     made of a 32-bit length followed by the zero terminated string,
+   - 'l' (integer) and 'd' (real): no payload, the value is in the next word,
+   - 't' (true), 'f' (false) and 'n' (null): no payload.
+   An object member is a string word (the name) followed by its value. */
+struct _json_tape_value {
+    uint64_t        word;
+};
+
+typedef struct {
+    size_t              size;       // whole allocation size
+    json_tape_value_t   tape[];     // root value first, then strings
+} json_tape_t;
+
+#define TAPE_TYPE_SHIFT     56
+#define TAPE_PAYLOAD_MASK   ( ( UINT64_C(1) << TAPE_TYPE_SHIFT ) - 1 )
+#define TAPE_COUNT_SHIFT    32
+#define TAPE_MAX_COUNT      0xffffff
+#define TAPE_MAX_LENGTH     0x7fffffff  // so that distances fit in 32 bits
+
+static inline uint64_t tape_word( unsigned char type, uint64_t payload )
+{
+    return ( (uint64_t)type << TAPE_TYPE_SHIFT ) | payload;
+}
+
+static inline unsigned char tape_type( const json_tape_value_t *value )
+{
+    return (unsigned char)( value->word >> TAPE_TYPE_SHIFT );
+}
+
+static inline uint64_t tape_payload( const json_tape_value_t *value )
+{
+    return value->word & TAPE_PAYLOAD_MASK;
+}
+
+// return the value following value on the tape
+static inline const json_tape_value_t *tape_skip(
+                                            const json_tape_value_t *value )
+{
+    switch ( tape_type( value ) ) {
+    case '{': case '[':
+        return value + (uint32_t)tape_payload( value );
+    case 'l': case 'd':
+        return value + 2;
+    default:
+        return value + 1;
+    }
+}
+
+// return the close word of a container
+static inline const json_tape_value_t *tape_close(
+                                            const json_tape_value_t *value )
+{
+    return tape_skip( value ) - 1;
+}
+
+static inline const unsigned char *tape_string( const json_tape_value_t *value,
+                                                uint32_t *length )
+{
+    const unsigned char *entry = (const unsigned char *)value +
+                                 tape_payload( value );
+    memcpy( length, entry, sizeof( uint32_t ) );
+    return entry + sizeof( uint32_t );
+}
+
+/*  -----------------------------------------------------------------
+    tape parsing
+    -----------------------------------------------------------------  */
+
+typedef struct {
+    json_parse_ctxt_t   lex;        // scalar tokens and errors
+    const unsigned char *buffer;
+    const uint32_t      *indexes;   // structural positions (stage 1)
+    size_t              nb_indexes;
+    size_t              next;       // next structural to process
+    json_tape_value_t   *words;     // next word to write
+    unsigned char       *strings;   // next string entry to write
+    unsigned char       *strings_end;
+} tape_ctxt_t;
+
+/* the lexer cursor follows the structural characters, so that it always
+   gives the error position, as if the lexer had read them */
+static inline int next_structural( tape_ctxt_t *ctxt )
+{
+    if ( ctxt->next >= ctxt->nb_indexes ) {
+        ctxt->lex.ptr = ctxt->lex.end;
+        ctxt->lex.at_end = true;
+        return EOF;
+    }
+    ctxt->lex.ptr = ctxt->buffer + ctxt->indexes[ ctxt->next++ ] + 1;
+    return ctxt->lex.ptr[-1];
+}
+
+static inline int peek_structural( tape_ctxt_t *ctxt )
+{
+    if ( ctxt->next >= ctxt->nb_indexes ) return EOF;
+    return ctxt->buffer[ ctxt->indexes[ ctxt->next ] ];
+}
+
+static bool write_string( tape_ctxt_t *ctxt )
+{
+    unsigned char *entry = ctxt->strings;
+    unsigned char *data = entry + sizeof( uint32_t );
+    /* decoded strings are never longer than in the text, so that they always
+       fit in the string area */
+    unsigned char *string = json_lex_string( &ctxt->lex, data,
+                                             ctxt->strings_end - data );
+    if ( NULL == string ) return false;
+    if ( string != data ) {
+        free( string );
+        json_lex_error( &ctxt->lex, JSON_STATUS_OUT_OF_MEMORY,
+                        "Out of memory while storing string" );
+        return false;
+    }
+    uint32_t length = (uint32_t)strlen( (const char *)data );
+    memcpy( entry, &length, sizeof( uint32_t ) );
+    ctxt->strings = data + length + 1;
+
+    ctxt->words->word = tape_word( '"', (uint64_t)( entry -
+                                       (unsigned char *)ctxt->words ) );
+    ++ctxt->words;
+    return true;
+}
+
+/* a scalar must be followed by a blank, a structural character or the end:
+   otherwise return the character found right after the scalar, which is
+   then reported as unexpected */
+static int next_after_scalar( tape_ctxt_t *ctxt )
+{
+    if ( ctxt->lex.ptr < ctxt->lex.end ) {
+        switch ( *ctxt->lex.ptr ) {
+        case ' ': case '\t': case '\n': case '\r':
+        case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+            break;
+        default:
+            return *ctxt->lex.ptr++;
+        }
+    }
+    return next_structural( ctxt );
+}
+
+static bool write_literal( tape_ctxt_t *ctxt, int c )
+{
+    static const char *literals[] = { "false", "null", "true" };
+    const char *literal = literals[ ( 'f' == c ) ? 0 : ( 'n' == c ) ? 1 : 2 ];
+
+    if ( ! json_lex_literal( &ctxt->lex, (const unsigned char *)literal ) )
+        return false;
+
+    ctxt->words->word = tape_word( (unsigned char)c, 0 );
+    ++ctxt->words;
+    return true;
+}
+
+static bool write_number( tape_ctxt_t *ctxt )
+{
+    number_t number;
+
+    --ctxt->lex.ptr;                // first character not consumed yet
+    if ( ! json_lex_number( &ctxt->lex, &number ) ) return false;
+
+    if ( JSON_INTEGER_NUMBER == number.ntype ) {
+        ctxt->words[0].word = tape_word( 'l', 0 );
+        ctxt->words[1].word = (uint64_t)number.ndata.integer;
+    } else {
+        ctxt->words[0].word = tape_word( 'd', 0 );
+        memcpy( &ctxt->words[1].word, &number.ndata.real, sizeof( double ) );
+    }
+    ctxt->words += 2;
+    return true;
+}
+
+/* The document grammar is processed iteratively, with an explicit stack of
+   open containers, which is limited to MAX_OPEN_DEPTH as in the tree parser */
+typedef struct {
+    json_tape_value_t   *open;      // open word
+    uint32_t            count;      // number of members or elements
+} open_container_t;
+
+static bool write_tape( tape_ctxt_t *ctxt )
+{
+    open_container_t stack[MAX_OPEN_DEPTH];
+    unsigned int depth = 0;
+    bool scalar;                    // last value written was not a container
+    int c;
+
+value:
+    c = next_structural( ctxt );
+    switch ( c ) {
+    case '{': case '[':
+        if ( depth == MAX_OPEN_DEPTH ) {
+            json_lex_error( &ctxt->lex, JSON_STATUS_OUT_OF_MEMORY,
+                            "ran out of allocated stack depth in processing %s",
+                            ( '{' == c ) ? "object" : "array" );
+            return false;
+        }
+        stack[depth].open = ctxt->words++;
+        stack[depth].open->word = tape_word( (unsigned char)c, 0 );
+        stack[depth].count = 0;
+        ++depth;
+
+        if ( peek_structural( ctxt ) == ( ( '{' == c ) ? '}' : ']' ) ) {
+            next_structural( ctxt );    // empty object or array is ok
+            goto close;
+        }
+        if ( '{' == c ) goto member;
+        goto value;
+    case '"':
+        if ( ! write_string( ctxt ) ) return false;
+        scalar = true;
+        break;
+    case 't': case 'f': case 'n':
+        if ( ! write_literal( ctxt, c ) ) return false;
+        scalar = true;
+        break;
+    case EOF:
+        json_lex_error( &ctxt->lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+                        "Syntax error (end of text) while expecting value" );
+        return false;
+    default:
+        if ( '-' != c && ! isdigit( c ) ) {
+            json_lex_wrong_char_error( &ctxt->lex, "while expecting value", c );
+            return false;
+        }
+        if ( ! write_number( ctxt ) ) return false;
+        scalar = true;
+        break;
+    }
+
+next:       // a value was written
+    c = ( scalar ) ? next_after_scalar( ctxt ) : next_structural( ctxt );
+    if ( 0 == depth ) {
+        if ( EOF == c ) return true;
+        json_lex_wrong_char_error( &ctxt->lex, "while expecting end of text", c );
+        return false;
+    }
+
+    ++stack[depth-1].count;
+    if ( '{' == tape_type( stack[depth-1].open ) ) {
+        if ( ',' == c ) goto member;
+        if ( '}' == c ) goto close;
+        json_lex_wrong_char_error( &ctxt->lex, "while expecting object member", c );
+        return false;
+    }
+    if ( ',' == c ) goto value;
+    if ( ']' == c ) goto close;
+    json_lex_wrong_char_error( &ctxt->lex, "while expecting ',' or ']'", c );
+    return false;
+
+member:
+    c = next_structural( ctxt );
+    if ( '"' != c ) {
+        json_lex_wrong_char_error( &ctxt->lex, "while expecting object member", c );
+        return false;
+    }
+    if ( ! write_string( ctxt ) ) return false;
+    if ( ':' != next_structural( ctxt ) ) {
+        json_lex_error( &ctxt->lex, JSON_STATUS_PARSE_SYNTAX_ERROR,
+            "Syntax error (missing ':') while expecting \"name\" : value" );
+        return false;
+    }
+    goto value;
+
+close:
+    {
+        open_container_t *top = &stack[--depth];
+        uint64_t distance = (uint64_t)( ctxt->words - top->open );
+        uint64_t count = ( top->count > TAPE_MAX_COUNT ) ? TAPE_MAX_COUNT
+                                                         : top->count;
+        unsigned char type = tape_type( top->open );
+
+        top->open->word = tape_word( type, ( count << TAPE_COUNT_SHIFT ) |
+                                           ( distance + 1 ) );
+        ctxt->words->word = tape_word( ( '{' == type ) ? '}' : ']', distance );
+        ++ctxt->words;
+    }
+    scalar = false;
+    goto next;
+}
+
+static const json_tape_value_t *parse_tape( tape_ctxt_t *ctxt, size_t len )
+{
+    uint32_t *indexes = malloc( ( len + 1 ) * sizeof( uint32_t ) );
+    if ( NULL == indexes ) {
+        json_lex_error( &ctxt->lex, JSON_STATUS_OUT_OF_MEMORY,
+                        "Out of memory while indexing text" );
+        return NULL;
+    }
+    bool unterminated;      // reported when the last string is read
+    size_t nb_indexes = json_find_structurals( ctxt->buffer, len,
+                                               indexes, &unterminated );
+
+    /* each structural character is at most 2 words (numbers). Each string
+       entry takes at most 5 bytes more than its text (length and zero) */
+    size_t nb_words = 2 * nb_indexes + 1;
+    size_t size = sizeof( json_tape_t ) + nb_words * sizeof( json_tape_value_t )
+                  + len + 5 * nb_indexes + 1;
+    json_tape_t *tape = malloc( size );
+    if ( NULL == tape ) {
+        free( indexes );
+        json_lex_error( &ctxt->lex, JSON_STATUS_OUT_OF_MEMORY,
+                        "Out of memory while allocating tape" );
+        return NULL;
+    }
+    tape->size = size;
+
+    ctxt->indexes = indexes;
+    ctxt->nb_indexes = nb_indexes;
+    ctxt->next = 0;
+    ctxt->words = tape->tape;
+    ctxt->strings = (unsigned char *)( tape->tape + nb_words );
+    ctxt->strings_end = (unsigned char *)tape + size;
+
+    if ( ! write_tape( ctxt ) ) {
+        free( tape );
+        tape = NULL;
+    }
+    free( indexes );
+    return ( tape ) ? tape->tape : NULL;
+}
+
+extern const json_tape_value_t *json_parse_tape( const unsigned char *buffer,
+                                                 size_t len,
+                                                 json_error_report_t *error )
+{
+    tape_ctxt_t ctxt;
+    json_lex_init_buffer( &ctxt.lex, buffer, len, false );
+    ctxt.buffer = buffer;
+
+    const json_tape_value_t *root = NULL;
+    if ( NULL == buffer ) {
+        json_lex_error( &ctxt.lex, JSON_STATUS_INVALID_PARAMETERS,
+                        "Empty source buffer" );
+    } else if ( len > TAPE_MAX_LENGTH ) {
+        json_lex_error( &ctxt.lex, JSON_STATUS_INVALID_PARAMETERS,
+                        "Source buffer too large for a tape" );
+    } else {
+        root = parse_tape( &ctxt, len );
+    }
+    json_lex_report( &ctxt.lex, error );
+    return root;
+}
+
+extern void json_free_tape( const json_tape_value_t *root )
+{
+    if ( NULL == root ) return;
+    free( (unsigned char *)root - offsetof( json_tape_t, tape ) );
+}
+
+/*  -----------------------------------------------------------------
+    tape access
+    -----------------------------------------------------------------  */
+
+extern json_value_type_t json_tape_get_value_type(
+                                            const json_tape_value_t *value )
+{
+    if ( NULL == value ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NOT_A_JSON_VALUE;
+    }
+    switch ( tape_type( value ) ) {
+    case '{':           return JSON_OBJECT;
+    case '[':           return JSON_ARRAY;
+    case '"':           return JSON_STRING;
+    case 'l': case 'd': return JSON_NUMBER;
+    case 't': case 'f': return JSON_BOOLEAN;
+    case 'n':           return JSON_NULL;
+    default:
+        JSON_DEBUG_ASSERT(0);
+        return NOT_A_JSON_VALUE;
+    }
+}
+
+extern bool json_tape_get_boolean_value( const json_tape_value_t *value )
+{
+    if ( NULL == value ||
+         ( 't' != tape_type( value ) && 'f' != tape_type( value ) ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return false;
+    }
+    return 't' == tape_type( value );
+}
+
+extern json_number_type_t json_tape_get_value_number_type(
+                                            const json_tape_value_t *value )
+{
+    if ( NULL == value ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NOT_A_JSON_NUMBER;
+    }
+    switch ( tape_type( value ) ) {
+    case 'l':   return JSON_INTEGER_NUMBER;
+    case 'd':   return JSON_REAL_NUMBER;
+    default:
+        JSON_DEBUG_ASSERT(0);
+        return NOT_A_JSON_NUMBER;
+    }
+}
+
+extern long long int json_tape_get_integer_value(
+                                            const json_tape_value_t *value )
+{
+    if ( NULL == value || 'l' != tape_type( value ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return 0;
+    }
+    return (long long int)value[1].word;
+}
+
+extern double json_tape_get_real_value( const json_tape_value_t *value )
+{
+    if ( NULL == value || 'd' != tape_type( value ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return 0.0;
+    }
+    double real;
+    memcpy( &real, &value[1].word, sizeof( double ) );
+    return real;
+}
+
+extern const unsigned char *json_tape_get_string_value(
+                                            const json_tape_value_t *value,
+                                            size_t *length )
+{
+    if ( NULL == value || '"' != tape_type( value ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NULL;
+    }
+    uint32_t string_length;
+    const unsigned char *string = tape_string( value, &string_length );
+    if ( length ) *length = string_length;
+    return string;
+}
+
+static int get_container_count( const json_tape_value_t *container )
+{
+    uint32_t count = (uint32_t)( tape_payload( container ) >> TAPE_COUNT_SHIFT );
+    if ( count < TAPE_MAX_COUNT ) return (int)count;
+
+    json_tape_iterator_t iterator;      // saturated: count them
+    json_tape_new_iterator( container, &iterator );
+    count = 0;
+    while ( iterator.next < iterator.end ) {
+        if ( '{' == tape_type( container ) ) ++iterator.next;  // name
+        iterator.next = tape_skip( iterator.next );
+        ++count;
+    }
+    return (int)count;
+}
+
+extern int json_tape_get_object_member_count( const json_tape_value_t *value )
+{
+    if ( NULL == value || '{' != tape_type( value ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return -1;
+    }
+    return get_container_count( value );
+}
+
+extern int json_tape_get_array_size( const json_tape_value_t *value )
+{
+    if ( NULL == value || '[' != tape_type( value ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return -1;
+    }
+    return get_container_count( value );
+}
+
+extern const json_tape_value_t *json_tape_search_for_object_member_by_name(
+                                            const json_tape_value_t *object,
+                                            const unsigned char *name )
+{
+    if ( NULL == object || '{' != tape_type( object ) || NULL == name ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NULL;
+    }
+    size_t length = strlen( (const char *)name );
+    const json_tape_value_t *end = tape_close( object );
+    for ( const json_tape_value_t *key = object + 1; key < end; ) {
+        uint32_t key_length;
+        const unsigned char *key_name = tape_string( key, &key_length );
+        if ( key_length == length && 0 == memcmp( key_name, name, length ) )
+            return key + 1;
+        key = tape_skip( key + 1 );
+    }
+    return NULL;
+}
+
+extern const json_tape_value_t *json_tape_get_array_element(
+                                            const json_tape_value_t *array,
+                                            size_t index )
+{
+    if ( NULL == array || '[' != tape_type( array ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NULL;
+    }
+    const json_tape_value_t *end = tape_close( array );
+    const json_tape_value_t *element = array + 1;
+    for ( ; element < end && index; --index )
+        element = tape_skip( element );
+    return ( element < end ) ? element : NULL;
+}
+
+extern bool json_tape_new_iterator( const json_tape_value_t *container,
+                                    json_tape_iterator_t *iterator )
+{
+    if ( NULL == container || NULL == iterator ||
+         ( '{' != tape_type( container ) && '[' != tape_type( container ) ) ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return false;
+    }
+    iterator->next = container + 1;
+    iterator->end = tape_close( container );
+    return true;
+}
+
+extern const json_tape_value_t *json_tape_iterate_object_member(
+                                            json_tape_iterator_t *iterator,
+                                            const unsigned char **name )
+{
+    if ( NULL == iterator ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NULL;
+    }
+    if ( iterator->next >= iterator->end ) return NULL;
+
+    const json_tape_value_t *key = iterator->next;
+    if ( name ) {
+        uint32_t length;
+        *name = tape_string( key, &length );
+    }
+    iterator->next = tape_skip( key + 1 );
+    return key + 1;
+}
+
+extern const json_tape_value_t *json_tape_iterate_array_element(
+                                            json_tape_iterator_t *iterator )
+{
+    if ( NULL == iterator ) {
+        JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
+        return NULL;
+    }
+    if ( iterator->next >= iterator->end ) return NULL;
+
+    const json_tape_value_t *element = iterator->next;
+    iterator->next = tape_skip( element );
+    return element;
+}
@@ -0,0 +1,107 @@
+
+#ifndef __JSONTAPE_H__
+#define __JSONTAPE_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "jsonvalue.h"
+#include "jsonparse.h"
+
+/* Read-only json documents stored on a tape.
+
+   Instead of a tree of values, the whole document is stored in a single
+   allocation, as a sequence of 64-bit words (the tape) in document order,
+   followed by all decoded strings. A container word gives the position of
+   the matching end of container, so that any value can be skipped at once.
+
+   The text is parsed in two stages: the first stage locates all structural
+   characters in the buffer, 64 bytes at a time (see json_find_structurals),
+   the second stage walks through those positions, without looking at the
+   blanks in between, and writes the tape. Strings, numbers and literals are
+   read exactly as json_parse_buffer_n does, and errors are reported the same
+   way, but comments are not accepted.
+
+   Tape values cannot be edited, and they are not json_value_t: they are
+   accessed with the functions below, which mirror those in jsonvalue.h.
+   Duplicate member names are kept in objects, in the text order. */
+
+typedef struct _json_tape_value json_tape_value_t;
+
+/* parse the len bytes of json text in buffer and return the root value of
+   the resulting document, or NULL in case of error. In that case, if the
+   argument error is not NULL, a json_error_report is filled and returned.
+   The error string is allocated on the heap and must be freed by the caller
+   after use.
+
+   The buffer is not needed anymore after parsing. The document must be freed
+   by calling json_free_tape with its root value.
+
+   Since positions and distances on the tape are 32-bit, the text must not be
+   longer than 2 GiB - 1 bytes (0x7fffffff): longer texts are rejected with
+   JSON_STATUS_INVALID_PARAMETERS, and must be parsed with another parser,
+   for example json_parse_buffer_n or json_parse_file. */
+extern const json_tape_value_t *json_parse_tape( const unsigned char *buffer,
+                                                 size_t len,
+                                                 json_error_report_t *error );
+
+/* free the whole document given by its root value */
+extern void json_free_tape( const json_tape_value_t *root );
+
+/* same as the corresponding functions in jsonvalue.h */
+extern json_value_type_t json_tape_get_value_type(
+                                            const json_tape_value_t *value );
+extern bool json_tape_get_boolean_value( const json_tape_value_t *value );
+extern json_number_type_t json_tape_get_value_number_type(
+                                            const json_tape_value_t *value );
+extern long long int json_tape_get_integer_value(
+                                            const json_tape_value_t *value );
+extern double json_tape_get_real_value( const json_tape_value_t *value );
+
+/* return the string value (zero-terminated UTF8 string) of a string value,
+   which is stored in the document. If length is not NULL, the string length
+   in bytes is returned in *length. */
+extern const unsigned char *json_tape_get_string_value(
+                                            const json_tape_value_t *value,
+                                            size_t *length );
+
+/* return the number of members of an object value, or the number of elements
+   of an array value, or -1 if the value is not an object or an array */
+extern int json_tape_get_object_member_count( const json_tape_value_t *value );
+extern int json_tape_get_array_size( const json_tape_value_t *value );
+
+/* return the value of the first member with the given name in an object, or
+   NULL if there is no such member. The object members are searched in order,
+   since there is no index on the tape. */
+extern const json_tape_value_t *json_tape_search_for_object_member_by_name(
+                                            const json_tape_value_t *object,
+                                            const unsigned char *name );
+
+/* return the array element at index, or NULL if index is out of bounds. The
+   array elements are skipped in order up to index. */
+extern const json_tape_value_t *json_tape_get_array_element(
+                                            const json_tape_value_t *array,
+                                            size_t index );
+
+/* iterators over object members or array elements. Unlike tree iterators,
+   they are not allocated: they can be declared locally and do not need to be
+   freed. The iteration returns NULL when all members or elements have been
+   returned. */
+typedef struct {
+    const json_tape_value_t *next;
+    const json_tape_value_t *end;
+} json_tape_iterator_t;
+
+/* initialize an iterator from an object or an array value. Return false if
+   the value is neither an object nor an array */
+extern bool json_tape_new_iterator( const json_tape_value_t *container,
+                                    json_tape_iterator_t *iterator );
+
+/* return the next member value, and its name in *name if name is not NULL */
+extern const json_tape_value_t *json_tape_iterate_object_member(
+                                            json_tape_iterator_t *iterator,
+                                            const unsigned char **name );
+
+extern const json_tape_value_t *json_tape_iterate_array_element(
+                                            json_tape_iterator_t *iterator );
+
+#endif /* __JSONTAPE_H__ */
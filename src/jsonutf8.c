@@ -1,5 +1,11 @@
 
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "jsonutf8.h"
 
 /* variable length 8 bit byte encoding */
@@ -75,30 +81,236 @@ extern unsigned int json_check_utf8( json_data_input_t *input )
     return nb_read;
 }
 
-static int get_data_from_string( json_data_input_t *data_input )
+#if ! defined(__AVX2__) && ! defined(__SSSE3__)
+/* Check one non ASCII code point in memory. Return a pointer to the first
+   byte after the code point if it is valid, or NULL otherwise */
+static const unsigned char *check_utf8_code_point( const unsigned char *ptr,
+                                                   const unsigned char *end )
 {
-    const unsigned char *string = data_input->ctxt;
-    int data = *string;
-    if ( data ) {
-        data_input->ctxt = (unsigned char *)(1 + string);
-        return data;
+    unsigned char byte = *ptr++;
+    unsigned char min = 0x80, max = 0xbf; // range of the first tail byte
+    int remaining;
+
+    if ( IS_UTF8_2(byte) ) {
+        if ( 0xc2 > byte )       /* illegal 1st byte */   return NULL;
+        remaining = 1;
+    } else if ( IS_UTF8_3(byte) ) {
+        if ( 0xe0 == byte )      min = 0xa0;
+        else if ( 0xed == byte ) max = 0x9f;
+        remaining = 2;
+    } else if ( IS_UTF8_4(byte) ) {
+        if ( 0xf0 == byte )      min = 0x90;
+        else if ( 0xf4 == byte ) max = 0x8f;
+        else if ( 0xf4 < byte )                           return NULL;
+        remaining = 3;
+    } else                       /* illegal first byte */ return NULL;
+
+    if ( end - ptr < remaining ) /* incomplete utf8 */    return NULL;
+    if ( *ptr < min || *ptr > max )                       return NULL;
+    for ( ++ptr; --remaining; ++ptr ) {
+        if ( ! IS_UTF8_TAIL(*ptr) )                       return NULL;
     }
-    return EOF;
+    return ptr;
 }
+#endif
 
-// in memory string
-extern bool json_is_utf8_string( const unsigned char *string )
+#if defined(__AVX2__) || defined(__SSSE3__)
+/*
+    Vectorized validation, following John Keiser and Daniel Lemire,
+    "Validating UTF-8 In Less Than One Instruction Per Byte" (2021).
+
+    Each byte is classified according to the high nibble of the previous
+    byte, the low nibble of the previous byte and the high nibble of the
+    byte itself, using 3 lookup tables of 16 entries. Each table entry is a
+    bit set of the errors that are possible given that nibble value, so that
+    an error is detected when the same bit is set in all 3 lookups. Missing
+    continuation bytes after 3 and 4 byte leads are checked separately.
+*/
+#define TOO_SHORT       (1 << 0) // 11______ 0_______ or 11______ 11______
+#define TOO_LONG        (1 << 1) // 0_______ 10______
+#define OVERLONG_3      (1 << 2) // 11100000 100_____
+#define TOO_LARGE       (1 << 3) // 11110100 1001____ and larger
+#define SURROGATE       (1 << 4) // 11101101 101_____
+#define OVERLONG_2      (1 << 5) // 1100000_ 10______
+#define TOO_LARGE_1000  (1 << 6) // 11110101 1000____ and larger
+#define OVERLONG_4      (1 << 6) // 11110000 1000____
+#define TWO_CONTS       (1 << 7) // 10______ 10______
+#define CARRY           ( TOO_SHORT | TOO_LONG | TWO_CONTS )
+
+static const char byte_1_high_table[ 16 ] = {
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS,
+    TOO_SHORT | OVERLONG_2,
+    TOO_SHORT,
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+};
+
+static const char byte_1_low_table[ 16 ] = {
+    (char)( CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4 ),
+    (char)( CARRY | OVERLONG_2 ),
+    (char)CARRY,
+    (char)CARRY,
+    (char)( CARRY | TOO_LARGE ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 ),
+    (char)( CARRY | TOO_LARGE | TOO_LARGE_1000 )
+};
+
+static const char byte_2_high_table[ 16 ] = {
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    (char)( TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 |
+            TOO_LARGE_1000 | OVERLONG_4 ),
+    (char)( TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE ),
+    (char)( TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE ),
+    (char)( TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE ),
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+/* a block is incomplete if its last 3 bytes are greater than those */
+static const char incomplete_table[ 32 ] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    (char)( 0xf0 - 1 ), (char)( 0xe0 - 1 ), (char)( 0xc0 - 1 )
+};
+
+#if defined(__AVX2__)
+#define UTF8_BLOCK_SIZE 32
+typedef __m256i utf8_block_t;
+#define load_block( _p )        _mm256_loadu_si256( (const __m256i *)(_p) )
+#define load_table( _t )        _mm256_broadcastsi128_si256(                  \
+                                    _mm_loadu_si128( (const __m128i *)(_t) ) )
+#define set_block( _c )         _mm256_set1_epi8( (char)(_c) )
+#define zero_block()            _mm256_setzero_si256()
+#define and_block( _a, _b )     _mm256_and_si256( (_a), (_b) )
+#define or_block( _a, _b )      _mm256_or_si256( (_a), (_b) )
+#define xor_block( _a, _b )     _mm256_xor_si256( (_a), (_b) )
+#define lookup( _t, _i )        _mm256_shuffle_epi8( (_t), (_i) )
+#define high_nibble( _b )       _mm256_and_si256( _mm256_srli_epi16( (_b), 4 ),\
+                                                  set_block( 0x0f ) )
+#define sub_saturate( _a, _b )  _mm256_subs_epu8( (_a), (_b) )
+#define is_ascii( _b )          ( 0 == _mm256_movemask_epi8( _b ) )
+#define is_zero( _b )           _mm256_testz_si256( (_b), (_b) )
+// previous bytes, shifted in from the previous block
+#define prev_bytes( _b, _p, _n ) _mm256_alignr_epi8( (_b),                    \
+                                 _mm256_permute2x128_si256( (_p), (_b), 0x21 ),\
+                                 16 - (_n) )
+#else
+#define UTF8_BLOCK_SIZE 16
+typedef __m128i utf8_block_t;
+#define load_block( _p )        _mm_loadu_si128( (const __m128i *)(_p) )
+#define load_table( _t )        _mm_loadu_si128( (const __m128i *)(_t) )
+#define set_block( _c )         _mm_set1_epi8( (char)(_c) )
+#define zero_block()            _mm_setzero_si128()
+#define and_block( _a, _b )     _mm_and_si128( (_a), (_b) )
+#define or_block( _a, _b )      _mm_or_si128( (_a), (_b) )
+#define xor_block( _a, _b )     _mm_xor_si128( (_a), (_b) )
+#define lookup( _t, _i )        _mm_shuffle_epi8( (_t), (_i) )
+#define high_nibble( _b )       _mm_and_si128( _mm_srli_epi16( (_b), 4 ),     \
+                                               set_block( 0x0f ) )
+#define sub_saturate( _a, _b )  _mm_subs_epu8( (_a), (_b) )
+#define is_ascii( _b )          ( 0 == _mm_movemask_epi8( _b ) )
+#define is_zero( _b )           ( 0xffff == _mm_movemask_epi8(                \
+                                    _mm_cmpeq_epi8( (_b), zero_block() ) ) )
+#define prev_bytes( _b, _p, _n ) _mm_alignr_epi8( (_b), (_p), 16 - (_n) )
+#endif
+
+static bool check_utf8_blocks( const unsigned char *ptr,
+                               const unsigned char *end )
 {
-    json_data_input_t input;
-    input.ctxt = (unsigned char *)string;
-    input.read_byte = get_data_from_string;
+    const utf8_block_t byte_1_high = load_table( byte_1_high_table );
+    const utf8_block_t byte_1_low = load_table( byte_1_low_table );
+    const utf8_block_t byte_2_high = load_table( byte_2_high_table );
+    const utf8_block_t max_complete = load_block( &incomplete_table[
+                                                32 - UTF8_BLOCK_SIZE ] );
+    const utf8_block_t low_nibble_mask = set_block( 0x0f );
+
+    utf8_block_t error = zero_block();
+    utf8_block_t previous = zero_block(), previous_incomplete = zero_block();
+    unsigned char last[ UTF8_BLOCK_SIZE ];
+
+    while ( ptr < end ) {
+        utf8_block_t block;
+        if ( end - ptr >= UTF8_BLOCK_SIZE ) {
+            block = load_block( ptr );
+        } else {                   // pad the last block with 0 (ASCII)
+            memset( last, 0, UTF8_BLOCK_SIZE );
+            memcpy( last, ptr, end - ptr );
+            block = load_block( last );
+        }
+        ptr += UTF8_BLOCK_SIZE;
 
-    while ( *((const unsigned char *)input.ctxt) ) {
-        if ( 0 == json_check_utf8( &input ) ) {
-            return false;
+        if ( is_ascii( block ) ) { // error if the previous block is incomplete
+            error = or_block( error, previous_incomplete );
+            previous = previous_incomplete = zero_block();
+            continue;
         }
+
+        utf8_block_t prev1 = prev_bytes( block, previous, 1 );
+        utf8_block_t special = and_block(
+                and_block( lookup( byte_1_high, high_nibble( prev1 ) ),
+                           lookup( byte_1_low,
+                                   and_block( prev1, low_nibble_mask ) ) ),
+                lookup( byte_2_high, high_nibble( block ) ) );
+
+        // bytes following 3 or 4 byte leads must be continuation bytes
+        utf8_block_t prev2 = prev_bytes( block, previous, 2 );
+        utf8_block_t prev3 = prev_bytes( block, previous, 3 );
+        utf8_block_t must_be_continuation = and_block( or_block(
+                                sub_saturate( prev2, set_block( 0xe0 - 0x80 ) ),
+                                sub_saturate( prev3, set_block( 0xf0 - 0x80 ) ) ),
+                                set_block( 0x80 ) );
+        error = or_block( error, xor_block( must_be_continuation, special ) );
+
+        previous_incomplete = sub_saturate( block, max_complete );
+        previous = block;
+    }
+    error = or_block( error, previous_incomplete );
+    return is_zero( error );
+}
+#endif
+
+/* Check if the len bytes at string are a valid UTF8 sequence. Whole blocks
+   of ASCII characters are skipped at once. */
+extern bool json_is_utf8_span( const unsigned char *string, size_t len )
+{
+#if defined(__AVX2__) || defined(__SSSE3__)
+    return check_utf8_blocks( string, string + len );
+#else
+    const unsigned char *ptr = string, *end = string + len;
+    while ( ptr < end ) {
+#if defined(__SSE2__)
+        if ( end - ptr >= 16 &&
+             0 == _mm_movemask_epi8( _mm_loadu_si128( (const __m128i *)ptr ) ) ) {
+            ptr += 16;
+            continue;
+        }
+#endif
+        if ( IS_UTF8_1(*ptr) ) {
+            ++ptr;
+            continue;
+        }
+        ptr = check_utf8_code_point( ptr, end );
+        if ( NULL == ptr ) return false;
     }
     return true;
+#endif
+}
+
+// in memory string
+extern bool json_is_utf8_string( const unsigned char *string )
+{
+    return json_is_utf8_span( string, strlen( (const char *)string ) );
 }
 
 /* ouput must have room for at least 4 bytes */
@@ -2,6 +2,7 @@
 #ifndef __JSONUTF8_H__
 #define __JSONUTF8_H__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -20,6 +21,10 @@ typedef struct _json_data_input {
    Return the number of bytes read if it is valid or return 0 otherwise */
 extern unsigned int json_check_utf8( json_data_input_t *input );
 
+/* Check if the len bytes in memory at string are valid UTF8 encoding. The
+   check is vectorized if the library is compiled for SSSE3 or AVX2. */
+extern bool json_is_utf8_span( const unsigned char *string, size_t len );
+
 /* Check if the input string is valid UTF8 encoding, up to the terminating 0 */
 extern bool json_is_utf8_string( const unsigned char *string );
 
@@ -7,282 +7,225 @@
 #include "jsonvalue.h"
 #include "jsondata.h"
 #include "jsonedit.h"
+#include "jsonarena.h"
+#include "jsonkey.h"
+#include "jsonhash.h"
 
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
 /*  -----------------------------------------------------------------
     hash table manipulation
     -----------------------------------------------------------------  */
 
-/*
-  Zero terminated UTF8 string hashing,
-  based on Bob Jenkin's one-at-a-time hash function.
-*/
-static uint32_t UTF8_string_hash( const unsigned char *string )
-{
-    uint32_t hash = 0;
-    unsigned char c;
+#define INDEX_EMPTY         0           // positions are stored + 1
+#define MAX_MEMBER_NUMBER   0x40000000  // 2^30, index size is 2^31
 
-    while ( ( c = *string++ ) ) {
-        hash += c;
-        hash += (hash << 10);
-        hash ^= (hash >> 6);
-    }
-    hash += (hash << 3);
-    hash ^= (hash >> 11);
-    return hash + (hash << 15);;
+static void index_member( uint32_t *index, uint32_t mask,
+                          uint32_t hash, uint32_t position )
+{
+    uint32_t slot = hash & mask;
+    while ( INDEX_EMPTY != index[slot] )
+        slot = ( slot + 1 ) & mask;
+    index[slot] = position + 1;
 }
 
-/* free the member possibly in a collision chain list.
-   Does not free the member name nor value.
-   Does not attempt to shrink the hash table,
-     as entries are randomly assigned
-   Does not update max_collision as it does not know
-     if max_colllision was reached at multiple places.
-   Check if any iterator is at this member and move it
-   back to the previous member in the iterator list.
-   Update collision list, update links in iteration list. */
-void object_remove_member( object_t *object, unsigned int index, member_t *member )
+/* Remove the member at the given index slot (position in small objects),
+   leaving a hole in the member table (the caller is responsible for the
+   member name and value). Members in the same probe sequence are moved back
+   into the freed slot so that they can still be found, instead of leaving a
+   deleted marker in the index. Iterators do not need to be updated, as
+   member positions do not change. */
+void object_remove_member( object_t *object, uint32_t slot )
 {
     // FIXME: make sure this code is multi-thread safe
-    member_t *prev = NULL, *cur = object->members[index];
-    while ( cur != member ) {
-        prev = cur;
-        cur = cur->next;
-        assert( cur );
-    }
-
-    for ( member_iterator_t *membit = object->iterators;
-                                            membit; membit = membit->next ) {
-        if ( member == membit->member ) {
-            membit->member = member->iprev;
+    uint32_t *index = object->index, mask = object->mask;
+    uint32_t position = ( index ) ? index[slot] - 1 : slot;
+    member_t *member = &object->members[position];
+    member->name = NULL;
+    member->value = NULL;
+    --object->nb_used;
+    if ( NULL == index ) return;    // small object
+
+    uint32_t next = slot;
+    while ( true ) {
+        next = ( next + 1 ) & mask;
+        uint32_t position = index[next];
+        if ( INDEX_EMPTY == position ) break;
+
+        uint32_t home = object->members[position - 1].hash & mask;
+        if ( ( ( next - slot ) & mask ) <= ( ( next - home ) & mask ) ) {
+            index[slot] = position; // slot is between home and next
+            slot = next;
         }
     }
-    if ( prev ) prev->next = member->next;
-    else        object->members[index] = member->next;
-
-    if ( member->iprev )  member->iprev->inext = member->inext;
-    if ( member->inext )  member->inext->iprev = member->iprev;
-    if ( object->ihead == member ) object->ihead = member->inext;
-    if ( object->itail == member ) object->itail = member->iprev;
-
-    free( member );
-    --object->nb_used;
+    index[slot] = INDEX_EMPTY;
 }
 
-// member is an already allocated and filled member, index is where to store
-// its pointer in the object member table - possibly as a collsion.
-// object ihead and itail are assumed to be correct at the time of the call.
-void object_store_member( object_t *object, unsigned int index, member_t *member )
+// member is an already filled member, which is copied at the end of the
+// member table. The table must have room for it (see object_make_room).
+void object_store_member( object_t *object, const member_t *member )
 {
-    unsigned int count = 0;
     // FIXME: make sure this code is multi-thread safe
-    if ( object->members[index] ) { // already valid entry
-        ++count;                    // collision
-
-        member_t *existing = object->members[index];
-        while ( existing->next ) {
-            existing = existing->next;
-            ++count;                // more collitions
-        }
-        existing->next = member;
-    } else {
-        object->members[index] = member;
-    }
-
-    if ( object->max_collision < count )
-        object->max_collision = count;
-
-    member->inext = NULL;
-    member->iprev = object->itail;
-
-    if ( object->itail ) {
-        object->itail->inext = member;
-    } else {
-        object->ihead = member;
-    }
-    object->itail = member;
+    assert( object->nb_entries < object->nb_allocated );
+    uint32_t position = object->nb_entries++;
+    object->members[position] = *member;
+    if ( object->index )
+        index_member( object->index, object->mask, member->hash, position );
     ++object->nb_used;
 }
 
-static void object_shuffle_members( object_t *object, member_t **old_table )
-{
-    assert( NULL == object->ihead->iprev );
-    assert( NULL == object->itail->inext );
-
-    member_t *old_start = object->ihead;    // save head of old member list
-    object->ihead = object->itail = NULL;   // start with new empty member table
-
-    member_t *old_next = NULL;              // for each old member
-    for ( member_t *member = old_start; member; member = old_next ) {
-        old_next = member->inext;           // temporarily save next old member
-        // make an identical new member (not in a collison chain by default)
-        member->next = NULL;
-        unsigned int index = member->hash % object->modulo; // new table index
-        assert( index < object->nb_allocated );
-        object_store_member( object, index, member );
-    }
-    free( old_table );
-}
-
-static uint32_t get_prime( uint32_t size )
-{
-    unsigned int i;
-    static const uint32_t greatest_prime[] = {
-        1,           /* 2^00            1 */
-        2,           /* 2^01            2 */
-        3,           /* 2^02            4 */
-        7,           /* 2^03            8 */
-        13,          /* 2^04           16 */
-        31,          /* 2^05           32 */
-        61,          /* 2^06           64 */
-        127,         /* 2^07          128 */
-        251,         /* 2^08          256 */
-        509,         /* 2^09          512 */
-        1021,        /* 2^10         1024 */
-        2039,        /* 2^11         2048 */
-        4093,        /* 2^12         4096 */
-        8191,        /* 2^13         8192 */
-        16381,       /* 2^14        16384 */
-        32749,       /* 2^15        32768 */
-        65521,       /* 2^16        65536 */
-        131071,      /* 2^17       131072 */
-        262139,      /* 2^18       262144 */
-        524287,      /* 2^19       524288 */
-        1048573,     /* 2^20      1048576 */
-        2097143,     /* 2^21      2097152 */
-        4194301,     /* 2^22      4194304 */
-        8388593,     /* 2^23      8388608 */
-        16777213,    /* 2^24     16777216 */
-        33554393,    /* 2^25     33554432 */
-        67108859,    /* 2^26     67108864 */
-        134217689,   /* 2^27    134217728 */
-        268435399,   /* 2^28    268435456 */
-        536870909,   /* 2^29    536870912 */
-        1073741789,  /* 2^30   1073741824 */
-        2147483647,  /* 2^31   2147483648 */
-        4294967291,  /* 2^32   4294967296 */
-    };
-
-    /* assuming size is a power of 2 */
-    for ( i = 0; size ; ++i )
-        size >>= 1;
-    if ( i > sizeof( greatest_prime ) / sizeof( unsigned int ) )
-        return 0;            // can't extend more than 64 GB!
-    return greatest_prime[i-1];
+// move iterators back by the number of holes before them
+static void object_compact_iterators( object_t *object )
+{
+    for ( member_iterator_t *membit = object->iterators;
+                                            membit; membit = membit->next ) {
+        uint32_t position = 0;
+        for ( uint32_t i = 0; i < membit->position; ++i ) {
+            if ( object->members[i].name ) ++position;
+        }
+        membit->position = position;
+    }
 }
 
 bool object_make_room( object_t *object )
 {
-    /* if less than 25% left or more than 4 colliding entries in list, double the size */
-    if ( ( 4 * (1 + object->nb_used) >= 3 * (object->nb_allocated) ) ||
-                                             object->max_collision > 4 ) {
-        uint32_t old_size = object->nb_allocated;
+    if ( object->nb_entries < object->nb_allocated )
+        return true;            // no need to extend
 
-        if ( 2147483648 == old_size ) // 2^31 is max object size
+    /* starting from MIN_MEMBER_NUMBER (power of 2), double the size, unless
+       at least half of the table is made of holes, which are just removed */
+    uint32_t new_allocated = object->nb_allocated;
+    if ( 0 == new_allocated ) {
+        new_allocated = MIN_MEMBER_NUMBER;
+    } else if ( object->nb_used >= new_allocated / 2 ) {
+        if ( MAX_MEMBER_NUMBER == new_allocated )
             return false;
+        new_allocated *= 2;
+    }
 
-        /* starting from MIN_MEMBER_NUMBER (power of 2), double the size */
-        unsigned int new_allocated = ( old_size ) ?  2 * old_size : MIN_MEMBER_NUMBER;
+    member_t *new_members = arena_malloc( object->arena,
+                                          sizeof(member_t) * new_allocated );
+    uint32_t *new_index = NULL, new_mask = 0;
+    if ( new_allocated > SMALL_OBJECT_SIZE ) {
+        new_mask = 2 * new_allocated - 1;
+        new_index = arena_malloc( object->arena,
+                                  sizeof(uint32_t) * ( new_mask + 1 ) );
+    }
+    if ( NULL == new_members ||
+         ( NULL == new_index && new_allocated > SMALL_OBJECT_SIZE ) ) {
+        arena_free( object->arena, new_members );
+        arena_free( object->arena, new_index );
+        return false;       // keep existing object if it cannot be extended
+    }
+    if ( new_index )
+        memset( (void *)new_index, 0, sizeof(uint32_t) * ( new_mask + 1 ) );
 
-        member_t **old_table = object->members;
-        member_t **new_table = malloc( sizeof(member_t *) * new_allocated );
-        if ( NULL == new_table )
-            return false;       // keep existing object if it cannot be extended
+    if ( object->nb_used != object->nb_entries )
+        object_compact_iterators( object );
 
-        memset( (void *)new_table, 0, sizeof(member_t *) * new_allocated );
-        object->members = new_table;
-        object->nb_allocated = new_allocated;
-        object->nb_used = 0;      // updated by object_shuffle_members if needed
-        object->modulo = get_prime( new_allocated );
-        assert ( object->modulo ); // guaranteed if max size is 2^31 only
-        object->max_collision = 0;
+    uint32_t nb_entries = 0;
+    for ( uint32_t i = 0; i < object->nb_entries; ++i ) {
+        member_t *member = &object->members[i];
+        if ( NULL == member->name ) continue;   // skip holes
 
-        if ( old_table ) {
-            object_shuffle_members ( object, old_table );
-        }
-        return true;         // object has been extended
+        new_members[nb_entries] = *member;
+        if ( new_index )
+            index_member( new_index, new_mask, member->hash, nb_entries );
+        ++nb_entries;
     }
-    return false;          // no need to extend
+    assert( nb_entries == object->nb_used );
+
+    arena_free( object->arena, object->members );
+    arena_free( object->arena, object->index );
+    object->members = new_members;
+    object->index = new_index;
+    object->nb_entries = nb_entries;
+    object->nb_allocated = new_allocated;
+    object->mask = new_mask;
+    return true;            // object has been extended
+}
+
+static inline bool member_has_name( const member_t *member, uint32_t hash,
+                                    const unsigned char *name, bool interned )
+{
+    if ( member->name == name )
+        return true;            // interned keys are unique, no need to compare
+    return member->hash == hash && ! ( interned && member->interned ) &&
+           0 == strcmp( (const char *)member->name, (const char *)name );
 }
 
 member_t *object_locate_existing_member( object_t *object, uint32_t hash,
                                          const unsigned char *name,
-                                         unsigned int *pindex )
-{
-    if ( NULL == object->members )
+                                         bool interned, uint32_t *pslot )
+{
+    if ( NULL == object->index ) {  // small object: linear search
+        for ( uint32_t position = 0; position < object->nb_entries; ++position ) {
+            member_t *member = &object->members[position];
+            if ( NULL == member->name ) continue;   // hole
+            if ( member_has_name( member, hash, name, interned ) ) {
+                if ( pslot )
+                    *pslot = position;
+                return member;
+            }
+        }
         return NULL;
+    }
 
-    unsigned int index = hash % object->modulo;
-    member_t *member = object->members[index];
+    uint32_t slot = hash & object->mask;
+    uint32_t position;
 
-    while( member ) {
-        if ( 0 == strcmp( (const char *)member->name, (const char *)name ) )
-            break;
-        member = member->next;
+    while ( INDEX_EMPTY != ( position = object->index[slot] ) ) {
+        member_t *member = &object->members[position - 1];
+        if ( member_has_name( member, hash, name, interned ) ) {
+            if ( pslot )
+                *pslot = slot;
+            return member;
+        }
+        slot = ( slot + 1 ) & object->mask;
     }
-    if ( pindex )
-        *pindex = index;
-
-    return member;
+    return NULL;
 }
 
 member_t *object_find_member( object_t *object, const unsigned char *name,
-                              unsigned int *pindex )
+                              uint32_t *pslot )
 {
     uint32_t hash = UTF8_string_hash( name );
-    return object_locate_existing_member( object, hash, name, pindex );
-}
-
-#if 0
-void debug_hash_table( hash_table_t *ht )
-{
-    printf( "Hash Table %p information\n", ht );
-    printf( "  allocated room  %d\n", ht->allocated );
-    printf( "  modulo          %d\n", ht->modulo );
-    printf( "  max collisions  %d\n", ht->max_collision );
-    printf( "  nb entries      %d\n\n", ht->nb );
-
-    printf( "  Entries {\n" );
-    hash_entry_t *entries = ht->table;
-    if ( entries ) {
-        for( int i = 0; i < ht->allocated; i++, entries++ ) {
-            if ( entries->key ) {
-                printf( "   Index %d, key %zu, hash %zu\n",
-                        i, (size_t)(entries->key), entries->hash );
-                for ( hash_entry_t *collide = entries->next; collide;
-                                              collide = collide->next ) {
-                    printf( "   Index %d, key %zu, hash %zu\n",
-                            i, (size_t)(collide->key), collide->hash );
-                }
-            }
-        }
-    }
-    printf( "  }\n");
+    return object_locate_existing_member( object, hash, name, false, pslot );
 }
 #endif
-#endif
 
 /*  -----------------------------------------------------------------
     freeing json object tree
     -----------------------------------------------------------------  */
 
+/* Note that in an arena only the values that were inserted in the heap after
+   parsing are freed, and the arena count of heap references is updated */
 void json_free_array( array_t *array )
 {
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
     if ( NULL == array ) return;
+    json_arena_t *arena = array->arena;
     element_iterator_t *eitn;
     for ( element_iterator_t *eit = array->iterators; eit; eit = eitn ) {
         eitn = eit->next;
         free( eit );
+        if ( arena ) --arena->heap_refs;
     }
+    array->iterators = NULL;
 
     unsigned int i = array->nb_used;
     while ( i-- ) {
-        json_free_value( array->elements[i] );
+        json_value_t *element = array->elements[i];
+        if ( arena && ! ( element->vflags & JSON_VALUE_NOT_IN_HEAP ) )
+            --arena->heap_refs;
+        json_free_value( element );
     }
 
-    free( array->elements );
-    free( array );
+    if ( NULL == arena ) {
+        free( array->elements );
+        free( array );
+    } else {                        // arena table stays, but becomes empty
+        array->nb_used = 0;
+    }
 #else
     element_t *next;
     for ( element_t *cur = array; cur; cur = next ) {
@@ -297,31 +240,38 @@ void json_free_object( object_t *object )
 {
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
     if ( NULL == object ) return;
+    json_arena_t *arena = object->arena;
     member_iterator_t *mitn;
     for ( member_iterator_t *mit = object->iterators; mit; mit = mitn ) {
         mitn = mit->next;
         free( mit );
+        if ( arena ) --arena->heap_refs;
     }
+    object->iterators = NULL;
 
-    member_t **mbp = object->members;
-    unsigned int nb = object->nb_used;
-    while ( nb ) {
-        member_t *mbn;
-        for ( member_t *mb = *mbp; mb; mb = mbn ) {
-            free( mb->name );
-            json_free_value( mb->value );
-            mbn = mb->next;
-            free( mb );
-            --nb;
-        }
-        ++mbp;
+    for ( uint32_t i = 0; i < object->nb_entries; ++i ) {
+        member_t *mb = &object->members[i];
+        if ( NULL == mb->name ) continue;       // hole
+        if ( arena && ! ( mb->value->vflags & JSON_VALUE_NOT_IN_HEAP ) )
+            --arena->heap_refs;
+        free_member_name( arena, mb );
+        json_free_value( mb->value );
+    }
+    if ( NULL == arena ) {
+        free( object->members );
+        free( object->index );
+        free( object );
+    } else {                        // arena tables stay, but become empty
+        if ( object->index )
+            memset( (void *)object->index, 0,
+                    sizeof(uint32_t) * ( object->mask + 1 ) );
+        object->nb_used = 0;
+        object->nb_entries = 0;
     }
-    free( object->members );
-    free( object );
 #else
     member_t *mbn;
     for ( member_t *mb = object; mb; mb = mbn ) {
-        free( mb->name );
+        free_member_name( NULL, mb );
         json_free_value( mb->value );
         mbn = mb->next;
         free( mb );
@@ -329,11 +279,40 @@ void json_free_object( object_t *object )
 #endif
 }
 
+/* A value allocated in an arena is not freed individually. Its sub trees are
+   walked only if heap values or iterators are still attached to the arena,
+   and the arena itself is released in one shot with the root value. */
+static void free_arena_value( json_value_t *value )
+{
+    json_arena_t *arena;
+    switch( value->vtype ) {
+    case JSON_OBJECT:
+        arena = value->vdata.object->arena;
+        if ( arena->heap_refs ) json_free_object( value->vdata.object );
+        break;
+    case JSON_ARRAY:
+        arena = value->vdata.array->arena;
+        if ( arena->heap_refs ) json_free_array( value->vdata.array );
+        break;
+    default:
+        break;
+    }
+    if ( value->vflags & JSON_VALUE_ARENA_ROOT )
+        json_release_arena( json_arena_from_root( value ) );
+}
+
 extern void json_free_value( json_value_t *value )
 // recursively free sub trees, if arrays or objects, before freeing the value
 {
     if ( NULL == value ) return; // json_free_value( NULL ) is valid
 
+    if ( value->vflags & JSON_VALUE_STATIC ) return; // shared, never freed
+
+    if ( value->vflags & JSON_VALUE_IN_ARENA ) {
+        free_arena_value( value );
+        return;
+    }
+
     switch( value->vtype ) {
     default:
         JSON_DEBUG_ASSERT(0);
@@ -345,12 +324,10 @@ extern void json_free_value( json_value_t *value )
         json_free_array( value->vdata.array );
         break;
     case JSON_STRING:
-        free( value->vdata.string );
-        break;
-    case JSON_NUMBER:
-        free( value->vdata.number );
+        if ( ! ( value->vflags & ( JSON_VALUE_SHORT_STRING | JSON_VALUE_IN_SITU ) ) )
+            free( value->vdata.string );
         break;
-    case JSON_BOOLEAN:  case JSON_NULL:
+    case JSON_NUMBER: case JSON_BOOLEAN:  case JSON_NULL:
         break;
     }
     free( value );
@@ -361,6 +338,77 @@ void json_free( json_value_t *root )
     json_free_value( root );
 }
 
+/*  -------------------------------------------------------------------
+    shared immutable values
+    -------------------------------------------------------------------  */
+
+#define STATIC_NULL { .vtype = JSON_NULL, .vflags = JSON_VALUE_STATIC }
+#define STATIC_BOOLEAN( _b )  { .vtype = JSON_BOOLEAN, \
+                                .vflags = JSON_VALUE_STATIC, \
+                                .vdata.boolean = (_b) }
+#define STATIC_INTEGER( _n )  { .vtype = JSON_NUMBER, \
+                                .vflags = JSON_VALUE_STATIC, \
+                                .vdata.number = { JSON_INTEGER_NUMBER, \
+                                                  { .integer = (_n) } } }
+#define STATIC_INTEGERS_4( _n )   STATIC_INTEGER( _n ),     \
+                                  STATIC_INTEGER( _n + 1 ), \
+                                  STATIC_INTEGER( _n + 2 ), \
+                                  STATIC_INTEGER( _n + 3 )
+#define STATIC_INTEGERS_16( _n )  STATIC_INTEGERS_4( _n ),     \
+                                  STATIC_INTEGERS_4( _n + 4 ), \
+                                  STATIC_INTEGERS_4( _n + 8 ), \
+                                  STATIC_INTEGERS_4( _n + 12 )
+#define STATIC_INTEGERS_64( _n )  STATIC_INTEGERS_16( _n ),      \
+                                  STATIC_INTEGERS_16( _n + 16 ), \
+                                  STATIC_INTEGERS_16( _n + 32 ), \
+                                  STATIC_INTEGERS_16( _n + 48 )
+
+static const json_value_t null_value = STATIC_NULL;
+static const json_value_t boolean_values[2] = {
+    STATIC_BOOLEAN( false ), STATIC_BOOLEAN( true )
+};
+static const json_value_t small_integer_values[] = {
+    STATIC_INTEGERS_64( SMALL_INTEGER_MIN ),
+    STATIC_INTEGERS_64( SMALL_INTEGER_MIN + 64 ),
+    STATIC_INTEGERS_64( SMALL_INTEGER_MIN + 128 ),
+    STATIC_INTEGERS_64( SMALL_INTEGER_MIN + 192 )
+};
+
+/* The API takes non-const values, but shared values are never modified: they
+   are flagged JSON_VALUE_STATIC and freeing them has no effect. */
+json_value_t *get_null_value( void )
+{
+    return (json_value_t *)&null_value;
+}
+
+json_value_t *get_boolean_value( bool boolean )
+{
+    return (json_value_t *)&boolean_values[ ( boolean ) ? 1 : 0 ];
+}
+
+json_value_t *get_small_integer_value( long long int integer )
+{
+    if ( integer < SMALL_INTEGER_MIN || integer > SMALL_INTEGER_MAX )
+        return NULL;
+    return (json_value_t *)&small_integer_values[ integer - SMALL_INTEGER_MIN ];
+}
+
+json_value_t *get_shared_value( const json_value_t *value )
+{
+    switch ( value->vtype ) {
+    case JSON_NULL:
+        return get_null_value( );
+    case JSON_BOOLEAN:
+        return get_boolean_value( value->vdata.boolean );
+    case JSON_NUMBER:
+        if ( JSON_INTEGER_NUMBER == value->vdata.number.ntype )
+            return get_small_integer_value( value->vdata.number.ndata.integer );
+        return NULL;
+    default:
+        return NULL;
+    }
+}
+
 /*  -------------------------------------------------------------------
     internal JSON tree access (no editing)
     -------------------------------------------------------------------  */
@@ -398,6 +446,8 @@ extern const unsigned char *json_get_string_value( const json_value_t *value )
         JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
         return NULL;
     }
+    if ( value->vflags & JSON_VALUE_SHORT_STRING )
+        return (const unsigned char *)value->vdata.short_string;
     return (const unsigned char *)value->vdata.string;
 }
 
@@ -408,27 +458,27 @@ extern json_number_type_t json_get_value_number_type(
         JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
         return NOT_A_JSON_NUMBER;
     }
-    return value->vdata.number->ntype;
+    return value->vdata.number.ntype;
 }
 
 extern long long int json_get_integer_value( const json_value_t *value )
 {
     if ( NULL == value || JSON_NUMBER != value->vtype ||
-         JSON_INTEGER_NUMBER != value->vdata.number->ntype) {
+         JSON_INTEGER_NUMBER != value->vdata.number.ntype) {
         JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
         return 0;
     }
-    return value->vdata.number->ndata.integer;
+    return value->vdata.number.ndata.integer;
 }
 
 extern double json_get_real_value( const json_value_t *value )
 {
     if ( NULL == value || JSON_NUMBER != value->vtype ||
-         JSON_REAL_NUMBER != value->vdata.number->ntype) {
+         JSON_REAL_NUMBER != value->vdata.number.ntype) {
         JSON_DEBUG_ASSERT(0); // exported API may be called with wrong args
         return 0.0;
     }
-    return value->vdata.number->ndata.real;
+    return value->vdata.number.ndata.real;
 }
 
 extern json_object_iterator_t json_new_object_iterator(
@@ -443,15 +493,8 @@ extern json_object_iterator_t json_new_object_iterator(
     if ( NULL == iterator ) return NULL;
 
     iterator->object = value->vdata.object;
-#if 0
-    if ( 0 == iterator->object->nb_used ) {
-        iterator->member = NULL;
-    } else {
-        iterator->member = iterator->object->ihead;
-    }
-#else
-    iterator->member = NULL;
-#endif
+    if ( iterator->object->arena ) ++iterator->object->arena->heap_refs;
+    iterator->position = 0;
     iterator->next = iterator->object->iterators;
     iterator->object->iterators = iterator;
 
@@ -481,16 +524,12 @@ extern const json_value_t *json_iterate_object_member(
         return NULL;
     }
 
-    if ( 0 == iterator->object->nb_used ) return NULL;
-
-    member_t *member = iterator->member;
-    if ( NULL == member ) {
-        member = iterator->object->ihead;
-    } else {
-        member = member->inext;
-        if ( NULL == member ) return NULL;
-    }
-    iterator->member = member;
+    object_t *object = iterator->object;
+    member_t *member;
+    do {                            // skip holes left by removed members
+        if ( iterator->position >= object->nb_entries ) return NULL;
+        member = &object->members[iterator->position++];
+    } while ( NULL == member->name );
 #else
     member_t *member = iterator;
     *object_iterator = (void *)(iterator->next);
@@ -516,6 +555,7 @@ extern void json_free_object_iterator( json_object_iterator_t object_iterator )
             if ( pmit ) pmit->next = mit->next;
             else object->iterators = mit->next;
             free( mit );
+            if ( object->arena ) --object->arena->heap_refs;
             return;
         }
     }
@@ -535,6 +575,7 @@ extern json_array_iterator_t json_new_array_iterator(
 
     iterator->index = 0;
     iterator->array = value->vdata.array;
+    if ( iterator->array->arena ) ++iterator->array->arena->heap_refs;
 
     iterator->next  = iterator->array->iterators;
     iterator->array->iterators = iterator;
@@ -589,6 +630,7 @@ extern void json_free_array_iterator( json_array_iterator_t array_iterator )
             if ( peit ) peit->next = eit->next;
             else array->iterators = eit->next;
             free( eit );
+            if ( array->arena ) --array->arena->heap_refs;
             return;
         }
     }
@@ -604,7 +646,7 @@ extern const json_value_t *json_search_for_object_member_by_name(
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
     uint32_t hash = UTF8_string_hash( name );
     member_t *member = object_locate_existing_member( vobject->vdata.object,
-                                                      hash, name, NULL );
+                                                      hash, name, false, NULL );
     if ( NULL == member ) return NULL;
     return member->value;
 #else
@@ -671,48 +713,61 @@ extern int json_get_array_size( const json_value_t *value )
     Json tree editing: adding, deleting, modifying values and members
     -------------------------------------------------------------------  */
 
-member_t *new_member( unsigned char *name, json_value_t *value )
+void set_member( member_t *member, unsigned char *name, json_value_t *value )
 {
-    member_t *member = malloc( sizeof( member_t ) );
-    if( member ) {
-        member->next = NULL;
-        member->name = name; // (*) name must have been allocated or duplicated !!
-        member->value = value;
+#ifndef _JSON_FAST_ACCESS_LARGER_CODE
+    member->next = NULL;
+#endif
+    member->name = name; // (*) name must have been allocated or duplicated !!
+    member->value = value;
+    member->interned = false;
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
-        member->hash = UTF8_string_hash( name );
-//        member->inext = member->iprev = NULL;
+    member->hash = UTF8_string_hash( name );
 #endif
-    } else {
-        free( name );       // callers free value as appropriate
-    }
-    return member;
 }
 
-void free_member( member_t *member )
+void set_interned_member( member_t *member, json_key_t *key,
+                          json_value_t *value )
 {
-    free( member->name );
+#ifndef _JSON_FAST_ACCESS_LARGER_CODE
+    member->next = NULL;
+#endif
+    member->name = key->name;   // the key reference is now the member's
+    member->value = value;
+    member->interned = true;
+#ifdef _JSON_FAST_ACCESS_LARGER_CODE
+    member->hash = key->hash;   // no need to hash again
+#endif
+}
+
+void free_member_name( json_arena_t *arena, member_t *member )
+{
+    if ( member->interned )
+        json_release_key( arena, member->name );
+    else
+        arena_free( arena, member->name );
+}
+
+static void free_member( json_arena_t *arena, member_t *member )
+{
+    free_member_name( arena, member );
     json_free_value( member->value );
-    free( member );
 }
 
-object_t *new_object( void )
+object_t *new_object( json_arena_t *arena )
 {
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
-    object_t *object = malloc( sizeof( object_t ) );
+    object_t *object = arena_malloc( arena, sizeof( object_t ) );
     if ( NULL == object ) return NULL;
 
+    object->arena = arena;
     object->iterators = NULL;
+    object->members = NULL;     // tables are allocated with the first member
+    object->index = NULL;
     object->nb_used = 0;
+    object->nb_entries = 0;
     object->nb_allocated = 0;
-    object->modulo = 0;
-    object->max_collision = 0;
-    object->members = NULL;
-    object->ihead = NULL;
-    object->itail = NULL;
-    if ( ! object_make_room( object ) ) { // try to create an initial table
-        free( object );                   // failed (no room), bail out
-        return NULL;
-    }
+    object->mask = 0;
     return object;
 #else
     return NULL;
@@ -727,26 +782,36 @@ object_t *object_attach_member( object_t *object, member_t *member,
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
     (void)last_member;  // suppress GCC warning
     assert( object );
-    member_t *entry = object_locate_existing_member( object, member->hash, member->name, NULL );
+    member_t *entry = object_locate_existing_member( object, member->hash,
+                                                     member->name,
+                                                     member->interned, NULL );
     if ( entry ) {
         printf( "json_parse: member %s exists already in object, ignoring duplicate\n",
                 member->name );
-        free_member( member );
+        free_member( object->arena, member );
         return object;                          // member exists already, ignore
     }
-    object_make_room( object );                 // extend if needed
-
-    unsigned int index = member->hash % object->modulo; // get possibly new index
-    object_store_member( object, index, member );
+    if ( ! object_make_room( object ) ) {       // extend if needed
+        free_member( object->arena, member );
+        return NULL;
+    }
+    object_store_member( object, member );
 #else
     for ( member_t *in_obj = object; in_obj; in_obj = in_obj->next ) {
         if ( 0 == strcmp( (const char *)in_obj->name, (const char *)member->name ) ) {
             printf( "json_parse: member %s exists already in object, ignoring duplicate\n",
                     member->name );
-            free_member( member );
+            free_member( NULL, member );
             return object;                      // member exists already, ignore
         }
     }
+    member_t *copy = malloc( sizeof( member_t ) );
+    if ( NULL == copy ) {
+        free_member( NULL, member );
+        return NULL;
+    }
+    *copy = *member;
+    member = copy;
     if ( *last_member )
         (*last_member)->next = member;
     else
@@ -757,16 +822,18 @@ object_t *object_attach_member( object_t *object, member_t *member,
     return object;
 }
 
-array_t *new_array( void )
+array_t *new_array( json_arena_t *arena )
 {
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
-    array_t *array = malloc( sizeof( array_t  ) );
+    array_t *array = arena_malloc( arena, sizeof( array_t  ) );
     if ( NULL == array ) return NULL;
 
     memset( array, 0, sizeof( array_t ) );
-    array->elements = malloc( sizeof( element_t *) * MIN_ELEMENT_NUMBER );
+    array->arena = arena;
+    array->elements = arena_malloc( arena,
+                                    sizeof( element_t *) * MIN_ELEMENT_NUMBER );
     if ( NULL == array->elements ) {
-        free( array );                    // bail out
+        arena_free( arena, array );       // bail out
         return NULL;
     }
     array->nb_allocated = MIN_ELEMENT_NUMBER;
@@ -781,8 +848,17 @@ array_t *new_array( void )
 element_t **array_grow( array_t *array )
 {
     unsigned int nb_allocated = array->nb_allocated * 2;
-    element_t **new_elements = realloc( array->elements,
-                                        sizeof( element_t *) * nb_allocated );
+    element_t **new_elements;
+    if ( array->arena ) {   // no realloc in arena, the old table is abandoned
+        new_elements = json_arena_alloc( array->arena,
+                                         sizeof( element_t *) * nb_allocated );
+        if ( new_elements )
+            memcpy( new_elements, array->elements,
+                    sizeof( element_t *) * array->nb_used );
+    } else {
+        new_elements = realloc( array->elements,
+                                sizeof( element_t *) * nb_allocated );
+    }
     if ( NULL == new_elements ) {
         return NULL;      // do not touch the original array.
     }
@@ -818,6 +894,30 @@ array_t *array_append_element( array_t *array, element_t *element,
     return array;
 }
 
+array_t *array_join( array_t *array, array_t *tail )
+{
+#ifdef _JSON_FAST_ACCESS_LARGER_CODE
+    while ( array->nb_allocated - array->nb_used < tail->nb_used ) {
+        if ( NULL == array_grow( array ) ) {
+            json_free_array( array );
+            json_free_array( tail );
+            return NULL;
+        }
+    }
+    memcpy( &array->elements[array->nb_used], tail->elements,
+            sizeof( element_t *) * tail->nb_used );
+    array->nb_used += tail->nb_used;
+    tail->nb_used = 0;              // elements now belong to array
+    json_free_array( tail );
+#else
+    if ( NULL == array ) return tail;
+    element_t *last = array;
+    while ( last->next ) last = last->next;
+    last->next = tail;
+#endif
+    return array;
+}
+
 element_t *new_element( json_value_t *value )
 {
 #ifdef _JSON_FAST_ACCESS_LARGER_CODE
@@ -834,14 +934,24 @@ element_t *new_element( json_value_t *value )
 #endif
 }
 
-number_t *new_number( json_number_type_t nbtype,
-                      long long int integer, double real )
+void set_number( number_t *number, json_number_type_t nbtype,
+                 long long int integer, double real )
+{
+    number->ntype = nbtype;
+    if ( JSON_INTEGER_NUMBER == nbtype ) { number->ndata.integer = integer; }
+    else                                 { number->ndata.real = real; }
+}
+
+bool set_string_copy( json_value_t *value, const unsigned char *string )
 {
-    number_t *number = malloc( sizeof( number_t ) );
-    if ( number ) {
-        number->ntype = nbtype;
-        if ( JSON_INTEGER_NUMBER == nbtype ) { number->ndata.integer = integer; }
-        else                                 { number->ndata.real = real; }
+    size_t size = 1 + strlen( (const char *)string );
+    if ( size <= SHORT_STRING_SIZE ) {
+        memcpy( value->vdata.short_string, string, size );
+        value->vflags |= JSON_VALUE_SHORT_STRING;
+        return true;
     }
-    return number;
+    value->vdata.string = malloc( size );
+    if ( NULL == value->vdata.string ) return false;
+    memcpy( value->vdata.string, string, size );
+    return true;
 }
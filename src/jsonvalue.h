@@ -88,7 +88,25 @@ extern const json_value_t *json_search_for_object_member_by_name(
 extern const json_value_t *json_get_array_element( const json_value_t *array,
                                                    unsigned int index );
 
+/* Member names are hashed with a random seed drawn once per process, so that
+   crafted documents cannot predict colliding names. The default hashing is
+   fast, but a public facing service may prefer a slower hashing resisting
+   hash flooding attacks even if hash values can be observed.
+
+   The mode is fixed for the whole process by the first call to
+   json_set_member_hashing, or when the first member name is hashed (as
+   objects are parsed or filled), whichever comes first, so that it should
+   be selected at the start of the program. Once fixed, asking for another
+   mode is refused with JSON_STATUS_INVALID_PARAMETERS and the mode does not
+   change, while asking for the same mode returns JSON_STATUS_SUCCESS. */
 typedef enum {
+    JSON_HASH_FAST,                 // word at a time or CRC32C (default)
+    JSON_HASH_SECURE                // SipHash-1-3
+} json_hash_mode_t;
+
+typedef enum {
+    JSON_STATUS_READ_ERROR = -14,       // the input could not be read
+    JSON_STATUS_STOPPED = -13,          // parsing stopped by a callback
     JSON_STATUS_INVALID_STRING = -12,
     JSON_STATUS_INVALID_PARAMETERS = -11,
     JSON_STATUS_INVALID_ENCODING = -10,
@@ -104,4 +122,7 @@ typedef enum {
     JSON_STATUS_SUCCESS = 0
 } json_status_t;
 
+/* select the member name hashing mode, see json_hash_mode_t above */
+extern json_status_t json_set_member_hashing( json_hash_mode_t mode );
+
 #endif /* __JSONVALUE_H__ */
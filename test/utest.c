@@ -1,8 +1,16 @@
 
 #include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
 
 #include "jsonvalue.h"
 #include "jsonparse.h"
+#include "jsontape.h"
+#include "jsonondemand.h"
+#include "jsonevent.h"
+#include "jsonpush.h"
+#include "jsonlines.h"
+#include "jsonparallel.h"
 #include "jsonedit.c"
 #include "jsonserial.h"
 
@@ -157,6 +165,96 @@ START_TEST( test_parser_empty_string, NO_SETUP )
 
 END_TEST( json_free_value( root ) )
 
+START_TEST( test_parser_escaped_string, NO_SETUP )
+
+    unsigned char buffer[] = "\"tab\\tquote\\\" \\u00e9\\ud834\\udd1e end\"";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    json_value_type_t value_type = json_get_value_type( root );
+    ASSERT_EQUAL( JSON_STRING, value_type );
+
+    const unsigned char *string_value = json_get_string_value( root );
+    ASSERT_EQUAL( 0, strcmp("tab\tquote\" \xc3\xa9\xf0\x9d\x84\x9e end",
+                            (const char *) string_value) );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_bad_escaped_string, NO_SETUP )
+
+    unsigned char buffer[] = "\"isolated \\ud834 head surrogate\"";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_EQUAL( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_INVALID_ENCODING, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_long_string, NO_SETUP )
+
+    // long strings are scanned in blocks: place special characters across
+    unsigned char buffer[] = "\"0123456789abcdefghijklmnopqrstuvwxyz0123456789\\\"\
+ABCDEFGHIJKLMNOPQRSTUVWXYZ\xc3\xa9 0123456789abcdefghijklmnopqrstuvwxyz\\\\\"";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    const unsigned char *string_value = json_get_string_value( root );
+    ASSERT_EQUAL( 0, strcmp( "0123456789abcdefghijklmnopqrstuvwxyz0123456789\"\
+ABCDEFGHIJKLMNOPQRSTUVWXYZ\xc3\xa9 0123456789abcdefghijklmnopqrstuvwxyz\\",
+                             (const char *) string_value) );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_bad_long_string, NO_SETUP )
+
+    unsigned char buffer[] = "\"0123456789abcdefghijklmnopqrstuvwxyz0123456789\
+ABCDEFGHIJKLMNOPQRSTUVWXYZ\t0123456789abcdefghijklmnopqrstuvwxyz\"";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_EQUAL( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_INVALID_STRING, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_short_strings, NO_SETUP )
+
+    // strings up to 15 bytes are stored inline, longer strings are allocated
+    unsigned char buffer[] = "[ \"\", \"fifteen bytes..\", \"sixteen bytes...\", \"\\u00e9t\\u00e9\" ]";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    const char *expected[] = { "", "fifteen bytes..", "sixteen bytes...",
+                               "\xc3\xa9t\xc3\xa9" };
+    for ( unsigned int i = 0; i < 4; ++i ) {
+        const unsigned char *string_value =
+                    json_get_string_value( json_get_array_element( root, i ) );
+        ASSERT_EQUAL( 0, strcmp( expected[i], (const char *)string_value ) );
+    }
+
+    json_value_t *duplicate = json_duplicate_value( root );
+    ASSERT_DIFFERENT( NULL, duplicate );
+    const unsigned char *string_value =
+                json_get_string_value( json_get_array_element( duplicate, 1 ) );
+    ASSERT_EQUAL( 0, strcmp( expected[1], (const char *)string_value ) );
+    json_free_value( duplicate );
+
+END_TEST( json_free_value( root ) )
+
 START_TEST( test_parser_integer_1, NO_SETUP )
 
     unsigned char buffer[] = "123";
@@ -217,6 +315,79 @@ START_TEST( test_parser_integer_3, NO_SETUP )
 
 END_TEST( json_free_value( root ) )
 
+START_TEST( test_parser_integer_4, NO_SETUP )
+
+    unsigned char buffer[] = "9007199254740993"; // 2^53 + 1, not a double
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    json_number_type_t number_type = json_get_value_number_type( root );
+    ASSERT_EQUAL( JSON_INTEGER_NUMBER, number_type );
+
+    long long int integer_value = json_get_integer_value( root );
+    ASSERT_EQUAL( 9007199254740993LL, integer_value );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_integer_5, NO_SETUP )
+
+    unsigned char buffer[] = "[ -9223372036854775808, 9223372036854775807, 9223372036854775808,"
+                             "  -9223372036854775809, 123456789012345678.9,"
+                             "  1234567890123456789.5, 1.234e3 ]";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    const json_value_t *element = json_get_array_element( root, 0 );
+    json_number_type_t number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_INTEGER_NUMBER, number_type );
+    long long int integer_value = json_get_integer_value( element );
+    ASSERT_EQUAL( INT64_MIN, integer_value );
+
+    element = json_get_array_element( root, 1 );
+    number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_INTEGER_NUMBER, number_type );
+    integer_value = json_get_integer_value( element );
+    ASSERT_EQUAL( INT64_MAX, integer_value );
+
+    // beyond the integer range, the number becomes real
+    element = json_get_array_element( root, 2 );
+    number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_REAL_NUMBER, number_type );
+    double real_value = json_get_real_value( element );
+    ASSERT_EQUAL( 9223372036854775808.0, real_value );
+
+    element = json_get_array_element( root, 3 );
+    number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_REAL_NUMBER, number_type );
+    real_value = json_get_real_value( element );
+    ASSERT_EQUAL( -9223372036854775808.0, real_value );
+
+    // a fraction stays real, even if rounding makes the double whole
+    element = json_get_array_element( root, 4 );
+    number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_REAL_NUMBER, number_type );
+    real_value = json_get_real_value( element );
+    ASSERT_EQUAL( 123456789012345678.9, real_value );
+
+    element = json_get_array_element( root, 5 );
+    number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_REAL_NUMBER, number_type );
+
+    // but an exact whole number written with a fraction is an integer
+    element = json_get_array_element( root, 6 );
+    number_type = json_get_value_number_type( element );
+    ASSERT_EQUAL( JSON_INTEGER_NUMBER, number_type );
+    integer_value = json_get_integer_value( element );
+    ASSERT_EQUAL( 1234, integer_value );
+
+END_TEST( json_free_value( root ) )
+
 START_TEST( test_parser_bad_integer_1, NO_SETUP )
 
     unsigned char buffer[] = "+123"; // + sign is not acceptable
@@ -470,6 +641,25 @@ START_TEST( test_parser_real_7, NO_SETUP )
 
 END_TEST( json_free_value( root ) )
 
+START_TEST( test_parser_real_8, NO_SETUP )
+
+    // many digits and a small exponent do not allow a fast conversion
+    unsigned char buffer[] = "3.14159265358979323846264338327950288419716939937510e-100";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    json_number_type_t number_type = json_get_value_number_type( root );
+    ASSERT_EQUAL( JSON_REAL_NUMBER, number_type );
+
+    double real_value = json_get_real_value( root );
+    double ref_value = 3.14159265358979323846264338327950288419716939937510e-100;
+    ASSERT_EQUAL( ref_value, real_value );
+
+END_TEST( json_free_value( root ) )
+
 START_TEST( test_parser_bad_real_1, NO_SETUP )
 
     unsigned char buffer[] = "123.e"; // missing digit after ,
@@ -1046,6 +1236,858 @@ START_TEST( test_parser_larger_object, NO_SETUP )
     }
 
 END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_blank_line_count, NO_SETUP )
+
+    // long indentations are skipped in blocks, lines must still be counted
+    unsigned char buffer[] = "[\n                                        1,\n\
+                                        \t\r\n                    \n\
+                                        x ]";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_EQUAL( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    ASSERT_DIFFERENT( NULL, strstr( error.error_string, "line 5, column 41:" ) );
+    ASSERT_EQUAL( 149, error.offset );
+    free( error.error_string );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_buffer_n_unterminated, NO_SETUP )
+
+    // the buffer is not zero terminated, only the first 7 bytes are parsed
+    const unsigned char buffer[] = { '[', '1', ',', ' ', '2', ' ', ']', 'x' };
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer_n( buffer, 7, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    json_value_type_t value_type = json_get_value_type( root );
+    ASSERT_EQUAL( JSON_ARRAY, value_type );
+
+    unsigned int array_size = json_get_array_size( root );
+    ASSERT_EQUAL( 2, array_size );
+
+    long long int integer_value =
+                    json_get_integer_value( json_get_array_element( root, 1 ) );
+    ASSERT_EQUAL( 2, integer_value );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_buffer_n_truncated, NO_SETUP )
+
+    unsigned char buffer[] = "true";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer_n( buffer, 3, 0, &error );
+    ASSERT_EQUAL( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_arena, NO_SETUP )
+
+    unsigned char buffer[] = "{ \"name\": \"arena\", \"values\": [ 1, 2.5, true, null ] }";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer_arena( buffer, sizeof(buffer) - 1,
+                                                  0, false, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    json_value_type_t value_type = json_get_value_type( root );
+    ASSERT_EQUAL( JSON_OBJECT, value_type );
+
+    const json_value_t *name = json_search_for_object_member_by_name( root,
+                                                (const unsigned char *)"name" );
+    ASSERT_EQUAL( 0, strcmp( "arena", (char *)json_get_string_value( name ) ) );
+
+    const json_value_t *values = json_search_for_object_member_by_name( root,
+                                              (const unsigned char *)"values" );
+    ASSERT_EQUAL( 4, json_get_array_size( values ) );
+    ASSERT_EQUAL( 2.5, json_get_real_value( json_get_array_element( values, 1 ) ) );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_bad_arena, NO_SETUP )
+
+    unsigned char buffer[] = "[ \"abc\", { \"x\": 1 }, 2, ]";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer_arena( buffer, sizeof(buffer) - 1,
+                                                  0, true, &error );
+    ASSERT_EQUAL( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_shared_values, NO_SETUP )
+
+    // null, booleans and small integers are shared, never allocated nor freed
+    unsigned char buffer[] = "[ null, true, false, 0, 254, 255, null, true ]";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    const json_value_t *null_value = json_get_array_element( root, 0 );
+    ASSERT_EQUAL( null_value, json_get_array_element( root, 6 ) );
+    ASSERT_EQUAL( json_get_array_element( root, 1 ), json_get_array_element( root, 7 ) );
+    ASSERT_EQUAL( true, json_get_boolean_value( json_get_array_element( root, 1 ) ) );
+    ASSERT_EQUAL( false, json_get_boolean_value( json_get_array_element( root, 2 ) ) );
+    ASSERT_EQUAL( 254, json_get_integer_value( json_get_array_element( root, 4 ) ) );
+    ASSERT_EQUAL( 255, json_get_integer_value( json_get_array_element( root, 5 ) ) );
+
+    json_value_t *new_null = json_new_value( JSON_NULL );
+    ASSERT_EQUAL( null_value, new_null );
+    json_value_t *duplicate = json_duplicate_value( json_get_array_element( root, 3 ) );
+    ASSERT_EQUAL( json_get_array_element( root, 3 ), duplicate );
+    json_free_value( new_null );
+    json_free_value( duplicate );
+
+    // a shared root parsed in an arena is freed with its arena
+    json_value_t *arena_root = json_parse_buffer_arena( (unsigned char *)"1", 1,
+                                                        0, false, &error );
+    ASSERT_DIFFERENT( NULL, arena_root );
+    ASSERT_EQUAL( 1, json_get_integer_value( arena_root ) );
+    json_free_value( arena_root );
+
+END_TEST( json_free_value( root ) )
+
+static const unsigned char *get_single_member_name( const json_value_t *object )
+{
+    const unsigned char *name = NULL;
+    json_object_iterator_t iterator = json_new_object_iterator( object );
+    json_iterate_object_member( &iterator, &name );
+    json_free_object_iterator( iterator );
+    return name;
+}
+
+START_TEST( test_parser_interned_names, NO_SETUP )
+
+    // all members with the same name share the same name string
+    unsigned char buffer[] = "[ { \"id\": 1 }, { \"id\": 2 }, { \"i\\u0064\": 3 } ]";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    const unsigned char *name = get_single_member_name( json_get_array_element( root, 0 ) );
+    ASSERT_EQUAL( 0, strcmp( "id", (const char *)name ) );
+    ASSERT_EQUAL( name, get_single_member_name( json_get_array_element( root, 1 ) ) );
+    ASSERT_EQUAL( name, get_single_member_name( json_get_array_element( root, 2 ) ) );
+
+    // removing an interned member returns a name the caller can free
+    unsigned char *name_to_free = NULL;
+    json_value_t *removed = json_remove_member_from_object(
+                (json_value_t *)json_get_array_element( root, 1 ),
+                (const unsigned char *)"id", &name_to_free );
+    ASSERT_DIFFERENT( NULL, removed );
+    ASSERT_EQUAL( 0, strcmp( "id", (const char *)name_to_free ) );
+    ASSERT_DIFFERENT( name, name_to_free );
+    free( name_to_free );
+    json_free_value( removed );
+
+    // a shared key table interns names across documents, and can be freed
+    // before or after them
+    json_key_table_t *keys = json_new_key_table( );
+    ASSERT_DIFFERENT( NULL, keys );
+    json_value_t *doc1 = json_parse_buffer_shared_keys(
+                (const unsigned char *)"{ \"key\": 1 }", 12, 0, keys, &error );
+    ASSERT_DIFFERENT( NULL, doc1 );
+    FILE *fd = tmpfile( );
+    ASSERT_DIFFERENT( NULL, fd );
+    fputs( "{ \"key\": \"two\" }", fd );
+    rewind( fd );
+    json_value_t *doc2 = json_parse_stream_shared_keys( fd, 0, keys, &error );
+    fclose( fd );
+    ASSERT_DIFFERENT( NULL, doc2 );
+    ASSERT_EQUAL( get_single_member_name( doc1 ), get_single_member_name( doc2 ) );
+    json_free_value( doc1 );
+    json_free_key_table( keys );
+    ASSERT_EQUAL( 0, strcmp( "key", (const char *)get_single_member_name( doc2 ) ) );
+    json_free_value( doc2 );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_hashing_mode, NO_SETUP )
+
+    // members were hashed by the previous tests: the mode cannot change
+    ASSERT_EQUAL( JSON_STATUS_INVALID_PARAMETERS,
+                  json_set_member_hashing( JSON_HASH_SECURE ) );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_set_member_hashing( JSON_HASH_FAST ) );
+
+    // and existing hash values are still valid
+    unsigned char buffer[64 * 32] = "{";
+    for ( int i = 0; i < 64; ++i ) {
+        sprintf( (char *)buffer + strlen( (char *)buffer ),
+                 "%s\"long member name %d\": %d", ( i ) ? ", " : "", i, i );
+    }
+    strcat( (char *)buffer, "}" );
+
+    json_error_report_t error;
+    json_value_t *root = json_parse_buffer( buffer, 0, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( 64, json_get_object_member_count( root ) );
+
+    unsigned char name[32];
+    for ( int i = 0; i < 64; ++i ) {
+        sprintf( (char *)name, "long member name %d", i );
+        const json_value_t *value = json_search_for_object_member_by_name( root, name );
+        ASSERT_DIFFERENT( NULL, value );
+        ASSERT_EQUAL( i, json_get_integer_value( value ) );
+    }
+    ASSERT_EQUAL( NULL, json_search_for_object_member_by_name( root,
+                                    (const unsigned char *)"long member name" ) );
+
+END_TEST( json_free_value( root ) )
+
+START_TEST( test_parser_tape, NO_SETUP )
+
+    unsigned char buffer[] = "{ \"name\": \"tape\", \"items\": [ 1, -2.5, true, null,\n"
+                             "  { \"a\": [] } ], \"escaped\": \"\\u00e9\\n\", \"name\": 2 }";
+    json_error_report_t error;
+
+    const json_tape_value_t *root = json_parse_tape( buffer, strlen( (char *)buffer ),
+                                                     &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_OBJECT, json_tape_get_value_type( root ) );
+    ASSERT_EQUAL( 4, json_tape_get_object_member_count( root ) );  // duplicate kept
+
+    const json_tape_value_t *name = json_tape_search_for_object_member_by_name( root,
+                                                (const unsigned char *)"name" );
+    ASSERT_EQUAL( JSON_STRING, json_tape_get_value_type( name ) );
+    ASSERT( 0 == strcmp( "tape", (const char *)json_tape_get_string_value( name, NULL ) ) );
+
+    size_t length;
+    const json_tape_value_t *escaped = json_tape_search_for_object_member_by_name( root,
+                                                (const unsigned char *)"escaped" );
+    ASSERT( 0 == strcmp( "\xc3\xa9\n",
+                         (const char *)json_tape_get_string_value( escaped, &length ) ) );
+    ASSERT_EQUAL( 3, length );
+
+    const json_tape_value_t *items = json_tape_search_for_object_member_by_name( root,
+                                                (const unsigned char *)"items" );
+    ASSERT_EQUAL( 5, json_tape_get_array_size( items ) );
+    ASSERT_EQUAL( 1, json_tape_get_integer_value( json_tape_get_array_element( items, 0 ) ) );
+    ASSERT_EQUAL( -2.5, json_tape_get_real_value( json_tape_get_array_element( items, 1 ) ) );
+    ASSERT_EQUAL( true, json_tape_get_boolean_value( json_tape_get_array_element( items, 2 ) ) );
+    ASSERT_EQUAL( JSON_NULL, json_tape_get_value_type( json_tape_get_array_element( items, 3 ) ) );
+    ASSERT_EQUAL( NULL, json_tape_get_array_element( items, 5 ) );
+
+    // iterators skip nested containers at once
+    json_tape_iterator_t iterator;
+    ASSERT( json_tape_new_iterator( root, &iterator ) );
+    const unsigned char *member_name;
+    const json_tape_value_t *value, *last = NULL;
+    int count = 0;
+    while ( NULL != ( value = json_tape_iterate_object_member( &iterator, &member_name ) ) ) {
+        last = value;
+        ++count;
+    }
+    ASSERT_EQUAL( 4, count );
+    ASSERT( 0 == strcmp( "name", (const char *)member_name ) );
+    ASSERT_EQUAL( 2, json_tape_get_integer_value( last ) );
+
+    ASSERT( json_tape_new_iterator( items, &iterator ) );
+    for ( count = 0; json_tape_iterate_array_element( &iterator ); ++count ) ;
+    ASSERT_EQUAL( 5, count );
+
+    // errors are the same as with the tree parser, with the right line
+    unsigned char bad[] = "[ 1,\n  2 x ]";
+    ASSERT_EQUAL( NULL, json_parse_tape( bad, strlen( (char *)bad ), &error ) );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    ASSERT( NULL != strstr( error.error_string, "line 2" ) );
+    ASSERT_EQUAL( 9, error.offset );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+    // and at the same offset when a token ends the text
+    const char *truncated[] = { "\"abc", "1e400", "-", "tru", "[ 1, " };
+    for ( size_t i = 0; i < sizeof( truncated ) / sizeof( truncated[0] ); ++i ) {
+        const unsigned char *text = (const unsigned char *)truncated[i];
+        size_t len = strlen( truncated[i] );
+        json_error_report_t tree_error;
+        ASSERT_EQUAL( NULL, json_parse_buffer_n( text, len, false, &tree_error ) );
+        ASSERT_EQUAL( NULL, json_parse_tape( text, len, &error ) );
+        ASSERT_EQUAL( tree_error.status, error.status );
+        ASSERT_EQUAL( tree_error.offset, error.offset );
+        free( tree_error.error_string );
+        free( error.error_string );
+    }
+
+END_TEST( json_free_tape( root ) )
+
+START_TEST( test_parser_ondemand, NO_SETUP )
+
+    unsigned char buffer[] = "{ \"skipped\": [ { \"a\": \"]}\" }, [ 1, 2 ] ],\n"
+                             "  \"items\": [ 10, -2.5, false ], \"n\\u0061me\": \"on demand\",\n"
+                             "  \"bad\": 12x }";
+    json_ondemand_doc_t *doc = json_ondemand_new_doc( buffer, strlen( (char *)buffer ) );
+    ASSERT_DIFFERENT( NULL, doc );
+
+    json_ondemand_value_t root, items, value;
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_root( doc, &root ) );
+    ASSERT_EQUAL( JSON_OBJECT, json_ondemand_get_value_type( &root ) );
+
+    // skipped values are only bracket-matched
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_search_for_object_member_by_name(
+                            &root, (const unsigned char *)"items", &items ) );
+    ASSERT_EQUAL( JSON_ARRAY, json_ondemand_get_value_type( &items ) );
+
+    long long int integer;
+    double real;
+    bool boolean;
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_array_element( &items, 0, &value ) );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_integer_value( &value, &integer ) );
+    ASSERT_EQUAL( 10, integer );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_array_element( &items, 1, &value ) );
+    ASSERT_EQUAL( JSON_STATUS_INVALID_PARAMETERS, json_ondemand_get_integer_value( &value, &integer ) );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_real_value( &value, &real ) );
+    ASSERT_EQUAL( -2.5, real );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_array_element( &items, 2, &value ) );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_boolean_value( &value, &boolean ) );
+    ASSERT_EQUAL( false, boolean );
+    ASSERT_EQUAL( JSON_STATUS_OUT_OF_BOUND, json_ondemand_get_array_element( &items, 3, &value ) );
+
+    // escaped member names are decoded before comparison
+    unsigned char *string;
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_search_for_object_member_by_name(
+                            &root, (const unsigned char *)"name", &value ) );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_get_string_value( &value, &string ) );
+    ASSERT( 0 == strcmp( "on demand", (char *)string ) );
+    free( string );
+    ASSERT_EQUAL( JSON_STATUS_NOT_A_MEMBER, json_ondemand_search_for_object_member_by_name(
+                            &root, (const unsigned char *)"missing", &value ) );
+
+    json_ondemand_iterator_t iterator;
+    const unsigned char *name;
+    int count = 0;
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_ondemand_new_iterator( &root, &iterator ) );
+    while ( JSON_STATUS_SUCCESS ==
+            json_ondemand_iterate_object_member( &iterator, &name, &value ) )
+        ++count;
+    ASSERT_EQUAL( 4, count );
+    ASSERT( 0 == strcmp( "bad", (const char *)name ) );
+
+    // invalid values are detected only when they are read
+    json_error_report_t error;
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, json_ondemand_get_integer_value( &value, &integer ) );
+    json_ondemand_get_error_report( doc, &error );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    ASSERT( NULL != strstr( error.error_string, "line 3" ) );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( json_ondemand_free_doc( doc ) )
+
+typedef struct {
+    int     depth, max_depth;
+    int     nb_keys, nb_values;
+    long long int sum;
+    int     stop_after;         // stop at that value if not 0
+} event_count_t;
+
+static bool count_start( void *user )
+{
+    event_count_t *count = user;
+    if ( ++count->depth > count->max_depth ) count->max_depth = count->depth;
+    return true;
+}
+
+static bool count_end( void *user )
+{
+    --((event_count_t *)user)->depth;
+    return true;
+}
+
+static bool count_key( void *user, const unsigned char *name, size_t length )
+{
+    (void)name; (void)length;
+    ++((event_count_t *)user)->nb_keys;
+    return true;
+}
+
+static bool count_integer( void *user, long long int integer )
+{
+    event_count_t *count = user;
+    count->sum += integer;
+    return ++count->nb_values != count->stop_after;
+}
+
+static bool count_value( void *user )
+{
+    event_count_t *count = user;
+    return ++count->nb_values != count->stop_after;
+}
+
+START_TEST( test_parser_events, NO_SETUP )
+
+    unsigned char buffer[] = "{ \"a\": [ 1, 2, { \"b\": 3, \"c\": [ null ] } ],\n"
+                             "  \"d\": 4 /* comment */ }";
+    json_event_callbacks_t callbacks = {
+        count_start, count_key, count_end, count_start, count_end,
+        NULL, count_integer, NULL, NULL, count_value
+    };
+    event_count_t count = { 0 };
+    json_error_report_t error;
+
+    json_status_t status = json_parse_buffer_events( buffer, strlen( (char *)buffer ),
+                                                     true, &callbacks, &count, &error );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, status );
+    ASSERT_EQUAL( 0, count.depth );
+    ASSERT_EQUAL( 4, count.max_depth );
+    ASSERT_EQUAL( 4, count.nb_keys );
+    ASSERT_EQUAL( 5, count.nb_values );
+    ASSERT_EQUAL( 10, count.sum );
+
+    // a callback can stop parsing
+    memset( &count, 0, sizeof( count ) );
+    count.stop_after = 2;
+    status = json_parse_buffer_events( buffer, strlen( (char *)buffer ),
+                                       true, &callbacks, &count, &error );
+    ASSERT_EQUAL( JSON_STATUS_STOPPED, status );
+    ASSERT_EQUAL( 3, count.sum );
+    free( error.error_string );
+
+    // same errors as the tree parser
+    memset( &count, 0, sizeof( count ) );
+    status = json_parse_buffer_events( buffer, strlen( (char *)buffer ),
+                                       false, &callbacks, &count, &error );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, status );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    ASSERT( NULL != strstr( error.error_string, "line 2" ) );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( )
+
+START_TEST( test_parser_push, NO_SETUP )
+
+    // every token is split across chunks of one byte
+    unsigned char buffer[] = "{ \"long name\": \"split \\\" string\", // comment\n"
+                             "  \"list\": [ -12.5e-1, true, null, 1234567 ] }";
+    size_t len = strlen( (char *)buffer );
+    json_parser_t *parser = json_new_parser( true, NULL, NULL );
+    ASSERT_DIFFERENT( NULL, parser );
+
+    for ( size_t i = 0; i < len - 1; ++i )
+        ASSERT_EQUAL( JSON_PARSER_NEED_MORE, json_parser_feed( parser, &buffer[i], 1 ) );
+    ASSERT_EQUAL( JSON_PARSER_DONE, json_parser_feed( parser, &buffer[len-1], 1 ) );
+    ASSERT_EQUAL( JSON_PARSER_DONE, json_parser_feed( parser, (const unsigned char *)" \n", 2 ) );
+    ASSERT_EQUAL( JSON_PARSER_DONE, json_parser_feed( parser, NULL, 0 ) );
+
+    json_value_t *root = json_parser_get_value( parser );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( NULL, json_parser_get_value( parser ) );
+
+    const json_value_t *value = json_search_for_object_member_by_name( root,
+                                        (const unsigned char *)"long name" );
+    ASSERT( 0 == strcmp( "split \" string", (const char *)json_get_string_value( value ) ) );
+    value = json_search_for_object_member_by_name( root, (const unsigned char *)"list" );
+    ASSERT_EQUAL( 4, json_get_array_size( value ) );
+    ASSERT_EQUAL( -1.25, json_get_real_value( json_get_array_element( value, 0 ) ) );
+    ASSERT_EQUAL( 1234567, json_get_integer_value( json_get_array_element( value, 3 ) ) );
+    json_free( root );
+    json_free_parser( parser );
+
+    // a root number is complete only at the end of text
+    parser = json_new_parser( false, NULL, NULL );
+    ASSERT_EQUAL( JSON_PARSER_NEED_MORE, json_parser_feed( parser, (const unsigned char *)"4", 1 ) );
+    ASSERT_EQUAL( JSON_PARSER_NEED_MORE, json_parser_feed( parser, (const unsigned char *)"2", 1 ) );
+    ASSERT_EQUAL( JSON_PARSER_DONE, json_parser_feed( parser, NULL, 0 ) );
+    root = json_parser_get_value( parser );
+    ASSERT_EQUAL( 42, json_get_integer_value( root ) );
+    json_free( root );
+    json_free_parser( parser );
+
+    // same errors as the tree parser, the partial tree is freed
+    json_error_report_t error;
+    parser = json_new_parser( false, NULL, NULL );
+    ASSERT_EQUAL( JSON_PARSER_NEED_MORE, json_parser_feed( parser, buffer, 20 ) );
+    ASSERT_EQUAL( JSON_PARSER_ERROR, json_parser_feed( parser, &buffer[20], len - 20 ) );
+    ASSERT_EQUAL( JSON_PARSER_ERROR, json_parser_feed( parser, NULL, 0 ) );
+    json_parser_get_error_report( parser, &error );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    ASSERT( NULL != strstr( error.error_string, "line 1" ) );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( json_free_parser( parser ) )
+
+typedef struct {
+    size_t  nb_values, nb_errors;
+    size_t  last_line;
+    bool    in_order;
+    size_t  stop_line;          // stop at that line if not 0
+} line_count_t;
+
+static bool count_line( void *user, size_t line, json_value_t *value,
+                        const json_error_report_t *error )
+{
+    line_count_t *count = user;
+    if ( line <= count->last_line ) count->in_order = false;
+    count->last_line = line;
+    if ( value ) {
+        // each line gives its own line number
+        if ( (long long int)line != json_get_integer_value(
+                json_search_for_object_member_by_name( value, (const unsigned char *)"n" ) ) )
+            count->in_order = false;
+        ++count->nb_values;
+        json_free( value );
+    } else if ( error && JSON_STATUS_PARSE_SYNTAX_ERROR == error->status ) {
+        ++count->nb_errors;
+    }
+    return line != count->stop_line;
+}
+
+START_TEST( test_parser_lines, NO_SETUP )
+
+    // many batches of lines, with blank lines and invalid lines
+    FILE *fd = tmpfile( );
+    ASSERT_DIFFERENT( NULL, fd );
+    for ( int i = 1; i <= 30000; ++i ) {
+        if ( 0 == i % 1000 )
+            fprintf( fd, "{ \"n\": %d, \"bad\" }\n", i );
+        else if ( 0 == i % 100 )
+            fprintf( fd, "  \r\n" );
+        else
+            fprintf( fd, "{ \"n\": %d, \"text\": \"line number %d\" }\n", i, i );
+    }
+
+    json_error_report_t error;
+    unsigned int threads[] = { 1, 4, 0 };
+    for ( int t = 0; t < 3; ++t ) {
+        line_count_t count = { 0, 0, 0, true, 0 };
+        rewind( fd );
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_parse_stream_lines( fd, false,
+                                threads[t], count_line, &count, &error ) );
+        ASSERT( count.in_order );
+        ASSERT_EQUAL( 29700, count.nb_values );
+        ASSERT_EQUAL( 30, count.nb_errors );
+        ASSERT_EQUAL( 30000, count.last_line );
+    }
+
+    // the callback can stop processing
+    line_count_t count = { 0, 0, 0, true, 12345 };
+    rewind( fd );
+    ASSERT_EQUAL( JSON_STATUS_STOPPED, json_parse_stream_lines( fd, false, 4,
+                                                count_line, &count, &error ) );
+    ASSERT_EQUAL( JSON_STATUS_STOPPED, error.status );
+    ASSERT_EQUAL( 12345, count.last_line );
+    free( error.error_string );
+
+    // a read error is not the end of the lines
+    FILE *wfd = fopen( "/dev/null", "w" );
+    ASSERT_DIFFERENT( NULL, wfd );
+    ASSERT_EQUAL( JSON_STATUS_READ_ERROR, json_parse_stream_lines( wfd, false, 1,
+                                                count_line, &count, &error ) );
+    fclose( wfd );
+    ASSERT_EQUAL( JSON_STATUS_READ_ERROR, error.status );
+    free( error.error_string );
+
+END_TEST( fclose( fd ) )
+
+static char *serialize_packed( const json_value_t *value )
+{
+    size_t length = json_get_serialization_length( value, PACKED_FORMAT );
+    char *text = malloc( length + 1 );
+    if ( text ) json_serialize( value, PACKED_FORMAT, length + 1, text );
+    return text;
+}
+
+START_TEST( test_parser_parallel, NO_SETUP )
+
+    // a root array large enough to be split
+    size_t size = 80000 * 64, len = 0;
+    unsigned char *buffer = malloc( size );
+    ASSERT_DIFFERENT( NULL, buffer );
+    len += sprintf( (char *)buffer, "[\n" );
+    for ( int i = 0; i < 80000; ++i )
+        len += sprintf( (char *)buffer + len,
+                        "%s{ \"id\": %d, \"s\": \"[\\\"%d,\", \"t\": [ 1.5, null ] }\n",
+                        ( i ) ? "," : "", i, i );
+    sprintf( (char *)buffer + len, "]" );
+    ++len;
+
+    json_error_report_t error;
+    json_value_t *sequential = json_parse_buffer_n( buffer, len, false, NULL );
+    json_value_t *parallel = json_parse_buffer_parallel( buffer, len, false, 4, &error );
+    ASSERT_DIFFERENT( NULL, parallel );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+    ASSERT_EQUAL( 80000, json_get_array_size( parallel ) );
+
+    char *text1 = serialize_packed( sequential ), *text2 = serialize_packed( parallel );
+    ASSERT( 0 == strcmp( text1, text2 ) );
+    free( text1 );
+    free( text2 );
+    json_free( parallel );
+
+    // the first error in the text is reported, as in sequence
+    memcpy( strstr( (char *)buffer, "\"id\": 60000" ), "\"id\"  60000", 11 );
+    memcpy( strstr( (char *)buffer, "\"id\": 70000" ), "\"id\": 7000]", 11 );
+    json_error_report_t expected;
+    ASSERT_EQUAL( NULL, json_parse_buffer_n( buffer, len, false, &expected ) );
+    ASSERT_EQUAL( NULL, json_parse_buffer_parallel( buffer, len, false, 4, &error ) );
+    ASSERT_EQUAL( expected.status, error.status );
+    ASSERT( 0 == strcmp( expected.error_string, error.error_string ) );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( expected.error_string );
+    free( error.error_string );
+
+END_TEST( json_free( sequential ); free( buffer ) )
+
+typedef struct {
+    const unsigned char *text;
+    size_t              left;
+    size_t              block_size;
+    unsigned char       block[8];
+} block_source_t;
+
+static size_t refill_block( json_block_source_t *source,
+                            const unsigned char **block )
+{
+    block_source_t *bs = source->src;
+    size_t len = ( bs->left < bs->block_size ) ? bs->left : bs->block_size;
+    memcpy( bs->block, bs->text, len );     // a block is valid until next call
+    bs->text += len;
+    bs->left -= len;
+    *block = bs->block;
+    return len;
+}
+
+START_TEST( test_parser_blocks, NO_SETUP )
+
+    // strings, numbers and comments split between tiny blocks
+    const char *text = "[ \"a long string \\u00e9\\\" split\", -12.5e-1, 123456789,\n"
+                       "  /* comment */ { \"name\": [ true, null ] }, // end\n"
+                       "  \"\\ud834\\udd1e\" ]";
+    size_t len = strlen( text );
+    json_value_t *expected = json_parse_buffer_n( (const unsigned char *)text, len,
+                                                  true, NULL );
+    ASSERT_DIFFERENT( NULL, expected );
+    char *expected_text = serialize_packed( expected );
+    json_free( expected );
+
+    json_error_report_t error;
+    for ( size_t size = 1; size <= 8; ++size ) {
+        block_source_t bs = { (const unsigned char *)text, len, size, { 0 } };
+        json_block_source_t source = { &bs, refill_block };
+        json_value_t *value = json_parse_block_source( &source, true, &error );
+        ASSERT_DIFFERENT( NULL, value );
+        char *value_text = serialize_packed( value );
+        json_free( value );
+        ASSERT( 0 == strcmp( expected_text, value_text ) );
+        free( value_text );
+    }
+
+    // '/' at the end of a block, followed by an invalid comment
+    const char *bad = "[ 1, /x ]";
+    block_source_t bs = { (const unsigned char *)bad, strlen( bad ), 6, { 0 } };
+    json_block_source_t source = { &bs, refill_block };
+    ASSERT_EQUAL( NULL, json_parse_block_source( &source, true, &error ) );
+    ASSERT_EQUAL( JSON_STATUS_PARSE_SYNTAX_ERROR, error.status );
+    ASSERT( NULL != strstr( error.error_string, "'/'" ) );
+    ASSERT( NULL != strstr( error.error_string, "line 1, column 6:" ) );
+    ASSERT_EQUAL( 5, error.offset );
+    free( error.error_string );
+
+    // a file descriptor is read by blocks
+    FILE *fd = tmpfile( );
+    ASSERT_DIFFERENT( NULL, fd );
+    fputs( text, fd );
+    fflush( fd );
+    rewind( fd );
+    json_value_t *value = json_parse_fd( fileno( fd ), true, &error );
+    fclose( fd );
+    ASSERT_DIFFERENT( NULL, value );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+    char *value_text = serialize_packed( value );
+    json_free( value );
+    ASSERT( 0 == strcmp( expected_text, value_text ) );
+    free( value_text );
+
+END_TEST( free( expected_text ) )
+
+START_TEST( test_parser_in_situ, NO_SETUP )
+
+    unsigned char buffer[] = "{ \"plain\": \"a string long enough not to be short\",\n"
+                             "  \"escaped\": \"tab\\there \\u00e9\\ud834\\udd1e\\\"\",\n"
+                             "  \"empty\": \"\" }";
+    unsigned char *end = buffer + sizeof( buffer );
+
+    json_error_report_t error;
+    json_value_t *root = json_parse_buffer_in_situ( buffer, sizeof( buffer ) - 1,
+                                                    false, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    // strings are decoded in place, and refer to the buffer
+    const char *names[] = { "plain", "escaped", "empty" };
+    const char *strings[] = { "a string long enough not to be short",
+                              "tab\there \xc3\xa9\xf0\x9d\x84\x9e\"", "" };
+    for ( int i = 0; i < 3; ++i ) {
+        const json_value_t *value = json_search_for_object_member_by_name(
+                                        root, (const unsigned char *)names[i] );
+        const unsigned char *string = json_get_string_value( value );
+        ASSERT( string > buffer && string < end );
+        ASSERT( 0 == strcmp( strings[i], (const char *)string ) );
+    }
+
+    // duplicated strings are copies
+    json_value_t *copy = json_duplicate_value( root );
+    ASSERT_DIFFERENT( NULL, copy );
+    const unsigned char *string = json_get_string_value(
+        json_search_for_object_member_by_name( copy, (const unsigned char *)"plain" ) );
+    ASSERT( string < buffer || string >= end );
+    json_free( copy );
+
+END_TEST( json_free( root ) )
+
+START_TEST( test_parser_max_depth, NO_SETUP )
+
+    // 1000 nested arrays and objects: [{"a":[{"a":...1...}]}]
+    size_t len = 0;
+    char *text = malloc( 1000 * 6 );
+    ASSERT_DIFFERENT( NULL, text );
+    for ( int i = 0; i < 1000; ++i )
+        len += sprintf( text + len, "%s", ( i & 1 ) ? "{\"a\":" : "[" );
+    text[len++] = '1';
+    for ( int i = 999; i >= 0; --i )
+        text[len++] = ( i & 1 ) ? '}' : ']';
+
+    json_error_report_t error;
+    ASSERT_EQUAL( NULL, json_parse_buffer_n( (unsigned char *)text, len, false, &error ) );
+    ASSERT_EQUAL( JSON_STATUS_OUT_OF_MEMORY, error.status );
+    free( error.error_string );
+    ASSERT_EQUAL( NULL, json_parse_buffer_max_depth( (unsigned char *)text, len,
+                                                     false, 999, &error ) );
+    ASSERT_EQUAL( JSON_STATUS_OUT_OF_MEMORY, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+    json_value_t *root = json_parse_buffer_max_depth( (unsigned char *)text, len,
+                                                      false, 1000, &error );
+    ASSERT_DIFFERENT( NULL, root );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+    const json_value_t *value = root;
+    for ( int i = 0; i < 1000; ++i ) {
+        value = ( i & 1 ) ?
+            json_search_for_object_member_by_name( value, (const unsigned char *)"a" ) :
+            json_get_array_element( value, 0 );
+        ASSERT_DIFFERENT( NULL, value );
+    }
+    ASSERT_EQUAL( 1, json_get_integer_value( value ) );
+    json_free( root );
+
+END_TEST( free( text ) )
+
+START_TEST( test_parser_file, NO_SETUP )
+
+    // a regular file is mapped and parsed in place
+    char path[] = "/tmp/utest_json_XXXXXX";
+    int fd = mkstemp( path );
+    ASSERT( -1 != fd );
+    const char *text = "{ \"file\": [ \"mapped\", 1, 2.5 ] }";
+    ASSERT_EQUAL( (ssize_t)strlen( text ), write( fd, text, strlen( text ) ) );
+    close( fd );
+
+    json_error_report_t error;
+    json_value_t *value = json_parse_file( path, false, &error );
+    unlink( path );
+    ASSERT_DIFFERENT( NULL, value );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+    char *value_text = serialize_packed( value );
+    json_free( value );
+    ASSERT( 0 == strcmp( "{\"file\":[\"mapped\",1,2.5]}", value_text ) );
+    free( value_text );
+
+    // the file does not exist anymore
+    ASSERT_EQUAL( NULL, json_parse_file( path, false, &error ) );
+    ASSERT_EQUAL( JSON_STATUS_INVALID_PARAMETERS, error.status );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+END_TEST( )
+
+START_TEST( test_parser_validate, NO_SETUP )
+
+    json_error_report_t error;
+    const char *valid = "{ \"a\": [ 1, -2.5e+3, true, null ], \"b\\u00e9\": "
+                        "\"x\\n\\\"\\uD834\\uDD1E\u00e9\", \"c\": {} }";
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS,
+                  json_validate_buffer( (const unsigned char *)valid,
+                                        strlen( valid ), false, &error ) );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, error.status );
+
+    // same errors as the tree parser
+    const char *invalid[] = { "[ 1, 2 ", "{ \"a\" 1 }", "[ 01 ]", "[ 1. ]",
+                              "[ \"\\x\" ]", "[ \"\\uD834\" ]", "[ \"\xC3\" ]",
+                              "[ \"a\tb\" ]", "[ 1 ] 2", "[ tru ]", NULL };
+    for ( int i = 0; invalid[i]; ++i ) {
+        json_error_report_t parse_error;
+        ASSERT_EQUAL( NULL, json_parse_buffer( (const unsigned char *)invalid[i],
+                                               false, &parse_error ) );
+        ASSERT_EQUAL( parse_error.status,
+                      json_validate_buffer( (const unsigned char *)invalid[i],
+                                            strlen( invalid[i] ), false, &error ) );
+        ASSERT( 0 == strcmp( parse_error.error_string, error.error_string ) );
+        PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+        free( parse_error.error_string );
+        free( error.error_string );
+    }
+
+    // long strings and deep nesting
+    size_t len = 2 * MAX_OPEN_DEPTH + 3 * 1000 + 2;
+    unsigned char *text = malloc( len + 1 );
+    ASSERT_DIFFERENT( NULL, text );
+    memset( text, '[', MAX_OPEN_DEPTH );
+    unsigned char *ptr = text + MAX_OPEN_DEPTH;
+    *ptr++ = '"';
+    for ( int i = 0; i < 1000; ++i ) {
+        memcpy( ptr, "\\tx", 3 );
+        ptr += 3;
+    }
+    *ptr++ = '"';
+    memset( ptr, ']', MAX_OPEN_DEPTH );
+    text[len] = 0;
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS,
+                  json_validate_buffer( text, len, false, &error ) );
+
+    FILE *fd = tmpfile( );
+    ASSERT_DIFFERENT( NULL, fd );
+    ASSERT_EQUAL( len, fwrite( text, 1, len, fd ) );
+    rewind( fd );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_validate_stream( fd, false, &error ) );
+
+    // one more level is too deep
+    ASSERT_EQUAL( ']', fputc( ']', fd ) );
+    memmove( text + 1, text, len );
+    text[0] = '[';
+    ASSERT_EQUAL( JSON_STATUS_OUT_OF_MEMORY,
+                  json_validate_buffer( text, len + 1, false, &error ) );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+
+    rewind( fd );       // the stream has now one ] too many
+    ASSERT_DIFFERENT( JSON_STATUS_SUCCESS,
+                      json_validate_stream( fd, false, &error ) );
+    PRINT_NORMAL( "Expected error: \"%s\"\n", error.error_string );
+    free( error.error_string );
+    fclose( fd );
+    free( text );
+
+END_TEST( )
+
 // ===============================================================
 
 START_TEST( test_new_null, NO_SETUP )
@@ -1085,6 +2127,23 @@ START_TEST( test_new_string, NO_SETUP )
 
 END_TEST( json_free_value( new_string ) )
 
+START_TEST( test_new_bad_string, NO_SETUP )
+
+    // valid UTF8 sequences followed by an overlong encoding of '/'
+    json_value_t *new_string = json_new_value( JSON_STRING,
+                "Hello json, \xc3\xa9t\xc3\xa9 \xe2\x82\xac \xf0\x9d\x84\x9e \xc0\xaf" );
+    ASSERT_EQUAL( NULL, new_string );
+
+    // truncated 3 byte sequence at the end
+    new_string = json_new_value( JSON_STRING,
+                "0123456789abcdefghijklmnopqrstuvwxyz \xe2\x82" );
+    ASSERT_EQUAL( NULL, new_string );
+
+    ASSERT( json_is_utf8_span( (const unsigned char *)"\xe2\x82\xac", 3 ) );
+    ASSERT( ! json_is_utf8_span( (const unsigned char *)"\xed\xa0\x80", 3 ) );
+
+END_TEST( json_free_value( new_string ) )
+
 START_TEST( test_new_integer, NO_SETUP )
 
     json_value_t *new_int = json_new_value( JSON_NUMBER, JSON_INTEGER_NUMBER, 17 );
@@ -2562,6 +3621,55 @@ START_TEST( test_object_remove_three, NO_SETUP )
 
 END_TEST( json_free_value( object ) )
 
+START_TEST( test_arena_edit, NO_SETUP )
+
+    unsigned char buffer[] = "{ \"array\": [ 1, 2 ], \"string\": \"parsed\" }";
+    json_error_report_t error;
+
+    json_value_t *root = json_parse_buffer_arena( buffer, sizeof(buffer) - 1,
+                                                  0, false, &error );
+    ASSERT_DIFFERENT( NULL, root );
+
+    // heap values inserted in the arena tree are freed with the tree
+    json_value_t *array = (json_value_t *)json_search_for_object_member_by_name(
+                                        root, (const unsigned char *)"array" );
+    for ( unsigned int i = 2; i < 40; ++i ) { // grow the arena table
+        json_value_t *element = json_new_value( JSON_NUMBER,
+                                                JSON_INTEGER_NUMBER, (long long)i );
+        json_status_t status = json_insert_element_into_array( array, i, element );
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, status );
+    }
+    ASSERT_EQUAL( 40, json_get_array_size( array ) );
+    ASSERT_EQUAL( 39, json_get_integer_value( json_get_array_element( array, 39 ) ) );
+
+    json_value_t *string = json_new_value( JSON_STRING, "heap" );
+    json_status_t status = json_insert_member_into_object( root,
+                                        (const unsigned char *)"new", string );
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, status );
+
+    // parsed values taken out of the tree can still be used and freed
+    unsigned char *old_name;
+    json_value_t *old_string = json_remove_member_from_object( root,
+                                    (const unsigned char *)"string", &old_name );
+    ASSERT_DIFFERENT( NULL, old_string );
+    ASSERT_EQUAL( 0, strcmp( "string", (char *)old_name ) );
+    ASSERT_EQUAL( 0, strcmp( "parsed", (char *)json_get_string_value( old_string ) ) );
+    free( old_name );
+    json_free_value( old_string );
+
+    json_value_t *old_element = json_replace_element_in_array( array, 0,
+                                                json_new_value( JSON_NULL ) );
+    ASSERT_EQUAL( 1, json_get_integer_value( old_element ) );
+    json_free_value( old_element );
+
+    // an iterator that is not freed is released with the tree
+    json_object_iterator_t iterator = json_new_object_iterator( root );
+    ASSERT_DIFFERENT( NULL, iterator );
+
+    ASSERT_EQUAL( 2, json_get_object_member_count( root ) );
+
+END_TEST( json_free_value( root ) )
+
 START_TEST( test_object_remove_all, NO_SETUP )
 
     json_value_t *object = json_new_value( JSON_OBJECT );
@@ -2663,6 +3771,202 @@ START_TEST( test_object_remove_all, NO_SETUP )
 
 END_TEST( json_free_value( object ) )
 
+START_TEST( test_object_iterate_while_editing, NO_SETUP )
+
+    // members are iterated in insertion order, even after the object grows
+    // and removed members are compacted while an iterator is active
+    json_value_t *object = json_new_value( JSON_OBJECT );
+    ASSERT_DIFFERENT( NULL, object );
+
+    unsigned char name[16];
+    for ( int i = 0; i < 8; ++i ) {
+        sprintf( (char *)name, "m%d", i );
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_insert_member_into_object(
+                object, name, json_new_value( JSON_NUMBER, JSON_INTEGER_NUMBER, i ) ) );
+    }
+
+    json_object_iterator_t iterator = json_new_object_iterator( object );
+    const unsigned char *member_name;
+    const json_value_t *value = json_iterate_object_member( &iterator, &member_name );
+    ASSERT_EQUAL( 0, strcmp( "m0", (const char *)member_name ) );
+    value = json_iterate_object_member( &iterator, &member_name );
+    ASSERT_EQUAL( 1, json_get_integer_value( value ) );
+
+    for ( int i = 0; i < 6; i += 2 ) {      // remove m0, m2 and m4
+        unsigned char *old_name;
+        sprintf( (char *)name, "m%d", i );
+        json_value_t *old_value = json_remove_member_from_object( object, name,
+                                                                  &old_name );
+        ASSERT_EQUAL( i, json_get_integer_value( old_value ) );
+        free( old_name );
+        json_free_value( old_value );
+    }
+    for ( int i = 8; i < 20; ++i ) {
+        sprintf( (char *)name, "m%d", i );
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, json_insert_member_into_object(
+                object, name, json_new_value( JSON_NUMBER, JSON_INTEGER_NUMBER, i ) ) );
+    }
+    ASSERT_EQUAL( 17, json_get_object_member_count( object ) );
+
+    int expected[] = { 3, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19 };
+    for ( unsigned int i = 0; i < sizeof(expected) / sizeof(int); ++i ) {
+        value = json_iterate_object_member( &iterator, &member_name );
+        ASSERT_DIFFERENT( NULL, value );
+        ASSERT_EQUAL( expected[i], json_get_integer_value( value ) );
+    }
+    ASSERT_EQUAL( NULL, json_iterate_object_member( &iterator, &member_name ) );
+    json_free_object_iterator( iterator );
+
+    value = json_search_for_object_member_by_name( object, (const unsigned char *)"m19" );
+    ASSERT_EQUAL( 19, json_get_integer_value( value ) );
+    ASSERT_EQUAL( NULL, json_search_for_object_member_by_name( object,
+                                                  (const unsigned char *)"m2" ) );
+
+END_TEST( json_free_value( object ) )
+
+// check that the object has exactly the members "k<keys[i]>" with the values
+// values[i], found by name and iterated in that order, and no member "k<absent>"
+static bool check_members( const json_value_t *object, unsigned int count,
+                           const int *keys, const int *values, int absent )
+{
+    if ( (int)count != json_get_object_member_count( object ) ) return false;
+
+    unsigned char name[16];
+    for ( unsigned int i = 0; i < count; ++i ) {
+        sprintf( (char *)name, "k%d", keys[i] );
+        const json_value_t *value = json_search_for_object_member_by_name( object, name );
+        if ( NULL == value || values[i] != json_get_integer_value( value ) )
+            return false;
+    }
+    sprintf( (char *)name, "k%d", absent );
+    if ( NULL != json_search_for_object_member_by_name( object, name ) )
+        return false;
+
+    json_object_iterator_t iterator = json_new_object_iterator( object );
+    const unsigned char *member_name;
+    bool in_order = true;
+    for ( unsigned int i = 0; i < count && in_order; ++i ) {
+        const json_value_t *value = json_iterate_object_member( &iterator,
+                                                                &member_name );
+        sprintf( (char *)name, "k%d", keys[i] );
+        in_order = value && values[i] == json_get_integer_value( value ) &&
+                   0 == strcmp( (const char *)name, (const char *)member_name );
+    }
+    if ( in_order && json_iterate_object_member( &iterator, &member_name ) )
+        in_order = false;
+    json_free_object_iterator( iterator );
+    return in_order;
+}
+
+static json_status_t insert_member( json_value_t *object, int key, int value )
+{
+    unsigned char name[16];
+    sprintf( (char *)name, "k%d", key );
+    return json_insert_member_into_object( object, name,
+                    json_new_value( JSON_NUMBER, JSON_INTEGER_NUMBER, value ) );
+}
+
+static bool remove_member( json_value_t *object, int key )
+{
+    unsigned char name[16], *old_name;
+    sprintf( (char *)name, "k%d", key );
+    json_value_t *old_value = json_remove_member_from_object( object, name,
+                                                              &old_name );
+    if ( NULL == old_value ) return false;
+    free( old_name );
+    json_free_value( old_value );
+    return true;
+}
+
+static bool replace_member( json_value_t *object, int key, int value )
+{
+    unsigned char name[16];
+    sprintf( (char *)name, "k%d", key );
+    json_value_t *old_value = json_replace_member_value_in_object( object, name,
+                    json_new_value( JSON_NUMBER, JSON_INTEGER_NUMBER, value ) );
+    if ( NULL == old_value ) return false;
+    json_free_value( old_value );
+    return true;
+}
+
+START_TEST( test_object_small_and_indexed, NO_SETUP )
+
+    // small objects (up to 8 members) are searched linearly, larger ones
+    // through an index: both must find the same members in the same order
+    json_value_t *object = json_new_value( JSON_OBJECT );
+    ASSERT_DIFFERENT( NULL, object );
+
+    for ( int i = 0; i < 8; ++i ) {
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, i, i ) );
+    }
+    int keys_8[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    ASSERT( check_members( object, 8, keys_8, keys_8, 8 ) );
+    ASSERT_EQUAL( JSON_STATUS_DUPLICATE_MEMBER, insert_member( object, 3, 3 ) );
+
+    // the 9th member creates the index
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, 8, 8 ) );
+    int keys_9[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+    ASSERT( check_members( object, 9, keys_9, keys_9, 9 ) );
+    ASSERT_EQUAL( JSON_STATUS_DUPLICATE_MEMBER, insert_member( object, 8, 8 ) );
+
+    for ( int i = 9; i < 12; ++i ) {
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, i, i ) );
+    }
+    int keys_12[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+    ASSERT( check_members( object, 12, keys_12, keys_12, 12 ) );
+
+    // back below 8 members
+    int removed[] = { 0, 3, 5, 7, 9 };
+    for ( unsigned int i = 0; i < sizeof(removed) / sizeof(int); ++i ) {
+        ASSERT( remove_member( object, removed[i] ) );
+    }
+    ASSERT( ! remove_member( object, 5 ) );
+    int keys_7[] = { 1, 2, 4, 6, 8, 10, 11 };
+    ASSERT( check_members( object, 7, keys_7, keys_7, 5 ) );
+
+    // replaced members keep their position
+    ASSERT( replace_member( object, 4, 40 ) );
+    ASSERT( replace_member( object, 11, 110 ) );
+    ASSERT( ! replace_member( object, 3, 30 ) );
+    int values_7[] = { 1, 2, 40, 6, 8, 10, 110 };
+    ASSERT( check_members( object, 7, keys_7, values_7, 3 ) );
+
+    // removed names can be inserted again, at the end, while holes are
+    // compacted and the table grows
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, 3, 33 ) );
+    for ( int i = 12; i < 20; ++i ) {
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, i, i ) );
+    }
+    int keys_16[] = { 1, 2, 4, 6, 8, 10, 11, 3, 12, 13, 14, 15, 16, 17, 18, 19 };
+    int values_16[] = { 1, 2, 40, 6, 8, 10, 110, 33, 12, 13, 14, 15, 16, 17, 18, 19 };
+    ASSERT( check_members( object, 16, keys_16, values_16, 0 ) );
+
+END_TEST( json_free_value( object ) )
+
+START_TEST( test_object_small_reinsert, NO_SETUP )
+
+    // a member removed from a full small object and inserted again moves to
+    // the end: the table is compacted, grows and gets its index at once
+    json_value_t *object = json_new_value( JSON_OBJECT );
+    ASSERT_DIFFERENT( NULL, object );
+
+    for ( int i = 0; i < 8; ++i ) {
+        ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, i, i ) );
+    }
+    ASSERT( remove_member( object, 2 ) );
+    int keys_7[] = { 0, 1, 3, 4, 5, 6, 7 };
+    ASSERT( check_members( object, 7, keys_7, keys_7, 2 ) );
+
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, 2, 2 ) );
+    int keys_8[] = { 0, 1, 3, 4, 5, 6, 7, 2 };
+    ASSERT( check_members( object, 8, keys_8, keys_8, 8 ) );
+
+    ASSERT_EQUAL( JSON_STATUS_SUCCESS, insert_member( object, 8, 8 ) );
+    int keys_9[] = { 0, 1, 3, 4, 5, 6, 7, 2, 8 };
+    ASSERT( check_members( object, 9, keys_9, keys_9, 9 ) );
+
+END_TEST( json_free_value( object ) )
+
 // ===========================================================================
 
 START_TEST( test_serialize_from_new_null, NO_SETUP )
@@ -2792,10 +4096,18 @@ BEGIN_TEST_SUITE( json_parser )
     test_parser_string();
     test_parser_bad_string();
     test_parser_empty_string();
+    test_parser_escaped_string();
+    test_parser_bad_escaped_string();
+    test_parser_long_string();
+    test_parser_bad_long_string();
+
+    test_parser_short_strings();
 
     test_parser_integer_1();
     test_parser_integer_2();
     test_parser_integer_3();
+    test_parser_integer_4();
+    test_parser_integer_5();
     test_parser_bad_integer_1();
     test_parser_bad_integer_2();
     test_parser_bad_integer_3();
@@ -2810,6 +4122,7 @@ BEGIN_TEST_SUITE( json_parser )
     test_parser_real_5();
     test_parser_real_6();
     test_parser_real_7();
+    test_parser_real_8();
     test_parser_bad_real_1();
     test_parser_bad_real_2();
     test_parser_bad_real_3();
@@ -2836,6 +4149,27 @@ BEGIN_TEST_SUITE( json_parser )
     test_parser_array_object_object();
     test_parser_larger_object();
 
+    test_parser_blank_line_count();
+    test_parser_buffer_n_unterminated();
+    test_parser_buffer_n_truncated();
+
+    test_parser_arena();
+    test_parser_bad_arena();
+    test_parser_shared_values();
+    test_parser_interned_names();
+    test_parser_hashing_mode();
+    test_parser_tape();
+    test_parser_ondemand();
+    test_parser_events();
+    test_parser_push();
+    test_parser_lines();
+    test_parser_parallel();
+    test_parser_blocks();
+    test_parser_in_situ();
+    test_parser_max_depth();
+    test_parser_file();
+    test_parser_validate();
+
 END_TEST_SUITE()
 
 BEGIN_TEST_SUITE( json_editor )
@@ -2843,6 +4177,7 @@ BEGIN_TEST_SUITE( json_editor )
     test_new_null();
     test_new_boolean();
     test_new_string();
+    test_new_bad_string();
     test_new_integer();
     test_new_real();
     test_new_array();
@@ -2879,6 +4214,11 @@ BEGIN_TEST_SUITE( json_editor )
     test_object_remove_three();
 
     test_object_remove_all();
+    test_object_iterate_while_editing();
+    test_object_small_and_indexed();
+    test_object_small_reinsert();
+
+    test_arena_edit();
 
 END_TEST_SUITE()
 